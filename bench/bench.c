@@ -0,0 +1,664 @@
+/*
+ *  Connection Manager UI
+ *
+ *  Copyright (C) 2012  Intel Corporation. All rights reserved.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License version 2.1,
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/*
+ * Microbenchmarks of the D-Bus encoding/decoding layer and of the
+ * service property handling. Messages are synthesized in-process and
+ * nothing is sent: the service code is built in this file with the
+ * sending functions replaced, and gdbus is stubbed out.
+ *
+ * Each N runs in its own process so that its peak RSS is reported
+ * alone. Allocations are counted on glibc only.
+ */
+
+#include <gdbus/gdbus.h>
+#include <dbus/dbus.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+static unsigned long allocations;
+
+#ifdef __GLIBC__
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size)
+{
+	allocations++;
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+	allocations++;
+	return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	allocations++;
+	return __libc_realloc(ptr, size);
+}
+#endif
+
+static unsigned long sent_messages;
+
+static dbus_bool_t bench_send_with_reply(DBusConnection *connection,
+					DBusMessage *message,
+					DBusPendingCall **pending_return,
+					int timeout_milliseconds)
+{
+	sent_messages++;
+	*pending_return = NULL;
+
+	return TRUE;
+}
+
+static dbus_bool_t bench_pending_call_set_notify(DBusPendingCall *pending,
+					DBusPendingCallNotifyFunction function,
+					void *user_data,
+					DBusFreeFunction free_user_data)
+{
+	if (free_user_data != NULL)
+		free_user_data(user_data);
+
+	return TRUE;
+}
+
+#define dbus_connection_send_with_reply bench_send_with_reply
+#define dbus_pending_call_set_notify bench_pending_call_set_notify
+
+#include "../lib/service.c"
+
+#undef dbus_connection_send_with_reply
+#undef dbus_pending_call_set_notify
+
+DBusConnection *g_dbus_setup_bus(DBusBusType type, const char *name,
+							DBusError *error)
+{
+	return NULL;
+}
+
+gboolean g_dbus_request_name(DBusConnection *connection, const char *name,
+							DBusError *error)
+{
+	return FALSE;
+}
+
+guint g_dbus_add_service_watch(DBusConnection *connection, const char *name,
+				GDBusWatchFunction connect,
+				GDBusWatchFunction disconnect,
+				void *user_data, GDBusDestroyFunction destroy)
+{
+	return 0;
+}
+
+static guint watch_id;
+
+guint g_dbus_add_signal_watch(DBusConnection *connection,
+				const char *sender, const char *path,
+				const char *interface, const char *member,
+				GDBusSignalFunction function, void *user_data,
+				GDBusDestroyFunction destroy)
+{
+	return ++watch_id;
+}
+
+gboolean g_dbus_remove_watch(DBusConnection *connection, guint tag)
+{
+	return TRUE;
+}
+
+void g_dbus_remove_all_watches(DBusConnection *connection)
+{
+}
+
+gboolean g_dbus_send_message(DBusConnection *connection, DBusMessage *message)
+{
+	sent_messages++;
+	dbus_message_unref(message);
+
+	return TRUE;
+}
+
+/* Synthesized messages */
+
+#define BENCH_PATH_FORMAT "/net/connman/service/wifi_%08x_managed_psk"
+
+static char **bench_paths;
+
+static void append_strings(DBusMessageIter *iter, void *user_data)
+{
+	const char **strings = user_data;
+
+	for (; *strings != NULL; strings++)
+		dbus_message_iter_append_basic(iter,
+					DBUS_TYPE_STRING, strings);
+}
+
+static void append_ipv4(DBusMessageIter *dict, void *user_data)
+{
+	const char *method = "dhcp", *address = "192.168.1.42";
+	const char *netmask = "255.255.255.0", *gateway = "192.168.1.1";
+
+	cui_dbus_append_dict_entry_basic(dict, "Method",
+					DBUS_TYPE_STRING, &method);
+	cui_dbus_append_dict_entry_basic(dict, "Address",
+					DBUS_TYPE_STRING, &address);
+	cui_dbus_append_dict_entry_basic(dict, "Netmask",
+					DBUS_TYPE_STRING, &netmask);
+	cui_dbus_append_dict_entry_basic(dict, "Gateway",
+					DBUS_TYPE_STRING, &gateway);
+}
+
+static void append_ipv6(DBusMessageIter *dict, void *user_data)
+{
+	const char *method = "auto", *address = "2001:db8::42";
+	const char *gateway = "fe80::1", *privacy = "disabled";
+	unsigned char prefix = 64;
+
+	cui_dbus_append_dict_entry_basic(dict, "Method",
+					DBUS_TYPE_STRING, &method);
+	cui_dbus_append_dict_entry_basic(dict, "Address",
+					DBUS_TYPE_STRING, &address);
+	cui_dbus_append_dict_entry_basic(dict, "PrefixLength",
+					DBUS_TYPE_BYTE, &prefix);
+	cui_dbus_append_dict_entry_basic(dict, "Gateway",
+					DBUS_TYPE_STRING, &gateway);
+	cui_dbus_append_dict_entry_basic(dict, "Privacy",
+					DBUS_TYPE_STRING, &privacy);
+}
+
+static void append_proxy(DBusMessageIter *dict, void *user_data)
+{
+	const char *servers[] = { "proxy1.example.com:3128",
+					"proxy2.example.com:3128", NULL };
+	const char *excludes[] = { "localhost", "example.com", NULL };
+	const char *method = "manual";
+
+	cui_dbus_append_dict_entry_basic(dict, "Method",
+					DBUS_TYPE_STRING, &method);
+	cui_dbus_append_dict_entry_array(dict, "Servers",
+			DBUS_TYPE_STRING, append_strings, servers);
+	cui_dbus_append_dict_entry_array(dict, "Excludes",
+			DBUS_TYPE_STRING, append_strings, excludes);
+}
+
+static void append_ethernet(DBusMessageIter *dict, void *user_data)
+{
+	const char *method = "auto", *interface = "wlan0";
+	const char *address = "00:11:22:33:44:55";
+	dbus_uint16_t mtu = 1500;
+
+	cui_dbus_append_dict_entry_basic(dict, "Method",
+					DBUS_TYPE_STRING, &method);
+	cui_dbus_append_dict_entry_basic(dict, "Interface",
+					DBUS_TYPE_STRING, &interface);
+	cui_dbus_append_dict_entry_basic(dict, "Address",
+					DBUS_TYPE_STRING, &address);
+	cui_dbus_append_dict_entry_basic(dict, "MTU",
+					DBUS_TYPE_UINT16, &mtu);
+}
+
+static void append_service(DBusMessageIter *dict, void *user_data)
+{
+	const char *nameservers[] = { "192.168.1.1", "8.8.8.8", NULL };
+	const char *timeservers[] = { "pool.ntp.org", NULL };
+	const char *domains[] = { "example.com", NULL };
+	const char *security[] = { "psk", "wps", NULL };
+	const char *empty[] = { NULL };
+	const char *type = "wifi", *state = "idle";
+	dbus_bool_t favorite = FALSE, immutable = FALSE;
+	dbus_bool_t autoconnect = FALSE, roaming = FALSE;
+	unsigned int index = *(unsigned int *) user_data;
+	unsigned char strength = index % 100;
+	char name[32];
+	const char *name_ptr = name;
+
+	snprintf(name, sizeof(name), "Network %u", index);
+
+	cui_dbus_append_dict_entry_basic(dict, "Type",
+					DBUS_TYPE_STRING, &type);
+	cui_dbus_append_dict_entry_array(dict, "Security",
+			DBUS_TYPE_STRING, append_strings, security);
+	cui_dbus_append_dict_entry_basic(dict, "State",
+					DBUS_TYPE_STRING, &state);
+	cui_dbus_append_dict_entry_basic(dict, "Strength",
+					DBUS_TYPE_BYTE, &strength);
+	cui_dbus_append_dict_entry_basic(dict, "Favorite",
+					DBUS_TYPE_BOOLEAN, &favorite);
+	cui_dbus_append_dict_entry_basic(dict, "Immutable",
+					DBUS_TYPE_BOOLEAN, &immutable);
+	cui_dbus_append_dict_entry_basic(dict, "AutoConnect",
+					DBUS_TYPE_BOOLEAN, &autoconnect);
+	cui_dbus_append_dict_entry_basic(dict, "Name",
+					DBUS_TYPE_STRING, &name_ptr);
+	cui_dbus_append_dict_entry_basic(dict, "Roaming",
+					DBUS_TYPE_BOOLEAN, &roaming);
+	cui_dbus_append_dict_entry_array(dict, "Nameservers",
+			DBUS_TYPE_STRING, append_strings, nameservers);
+	cui_dbus_append_dict_entry_array(dict, "Nameservers.Configuration",
+			DBUS_TYPE_STRING, append_strings, empty);
+	cui_dbus_append_dict_entry_array(dict, "Timeservers",
+			DBUS_TYPE_STRING, append_strings, timeservers);
+	cui_dbus_append_dict_entry_array(dict, "Timeservers.Configuration",
+			DBUS_TYPE_STRING, append_strings, empty);
+	cui_dbus_append_dict_entry_array(dict, "Domains",
+			DBUS_TYPE_STRING, append_strings, domains);
+	cui_dbus_append_dict_entry_array(dict, "Domains.Configuration",
+			DBUS_TYPE_STRING, append_strings, empty);
+	cui_dbus_append_dict_entry_dict(dict, "IPv4", append_ipv4, NULL);
+	cui_dbus_append_dict_entry_dict(dict, "IPv4.Configuration",
+							append_ipv4, NULL);
+	cui_dbus_append_dict_entry_dict(dict, "IPv6", append_ipv6, NULL);
+	cui_dbus_append_dict_entry_dict(dict, "IPv6.Configuration",
+							append_ipv6, NULL);
+	cui_dbus_append_dict_entry_dict(dict, "Proxy", append_proxy, NULL);
+	cui_dbus_append_dict_entry_dict(dict, "Proxy.Configuration",
+							append_proxy, NULL);
+	cui_dbus_append_dict_entry_dict(dict, "Ethernet",
+							append_ethernet, NULL);
+}
+
+static DBusMessage *new_get_services_reply(unsigned int n)
+{
+	DBusMessageIter iter, array, strt;
+	DBusMessage *message;
+	unsigned int i;
+
+	message = dbus_message_new_signal("/", "net.connman.Manager",
+							"ServicesChanged");
+	if (message == NULL)
+		return NULL;
+
+	dbus_message_iter_init_append(message, &iter);
+
+	dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY,
+			DBUS_STRUCT_BEGIN_CHAR_AS_STRING
+			DBUS_TYPE_OBJECT_PATH_AS_STRING
+			DBUS_TYPE_ARRAY_AS_STRING
+			DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+			DBUS_TYPE_STRING_AS_STRING DBUS_TYPE_VARIANT_AS_STRING
+			DBUS_DICT_ENTRY_END_CHAR_AS_STRING
+			DBUS_STRUCT_END_CHAR_AS_STRING, &array);
+
+	for (i = 0; i < n; i++) {
+		dbus_message_iter_open_container(&array, DBUS_TYPE_STRUCT,
+								NULL, &strt);
+		dbus_message_iter_append_basic(&strt, DBUS_TYPE_OBJECT_PATH,
+							&bench_paths[i]);
+		cui_dbus_append_dict(&strt, NULL, append_service, &i);
+		dbus_message_iter_close_container(&array, &strt);
+	}
+
+	dbus_message_iter_close_container(&iter, &array);
+
+	return message;
+}
+
+static DBusMessage *new_property_changed(const char *path,
+						unsigned char strength)
+{
+	DBusMessage *message;
+	DBusMessageIter iter;
+
+	message = dbus_message_new_signal(path, CONNMAN_SERVICE_INTERFACE,
+							"PropertyChanged");
+	if (message == NULL)
+		return NULL;
+
+	dbus_message_iter_init_append(message, &iter);
+	cui_dbus_append_basic(&iter, "Strength", DBUS_TYPE_BYTE, &strength);
+
+	return message;
+}
+
+/* Fills dicts with the a{sv} iterator of each service in the reply */
+static unsigned int get_service_dicts(DBusMessage *reply,
+				DBusMessageIter *dicts, const char **paths)
+{
+	DBusMessageIter iter, array, strt;
+	unsigned int n = 0;
+
+	dbus_message_iter_init(reply, &iter);
+	dbus_message_iter_recurse(&iter, &array);
+
+	while (dbus_message_iter_get_arg_type(&array) == DBUS_TYPE_STRUCT) {
+		dbus_message_iter_recurse(&array, &strt);
+		dbus_message_iter_get_basic(&strt, &paths[n]);
+		dbus_message_iter_next(&strt);
+		dicts[n++] = strt;
+
+		dbus_message_iter_next(&array);
+	}
+
+	return n;
+}
+
+/* Measurement */
+
+struct measure {
+	struct timespec start;
+	unsigned long allocations;
+};
+
+static void measure_start(struct measure *measure)
+{
+	measure->allocations = allocations;
+	clock_gettime(CLOCK_MONOTONIC, &measure->start);
+}
+
+static void measure_stop(struct measure *measure, const char *name,
+						unsigned int n, unsigned long ops)
+{
+	unsigned long allocs = allocations - measure->allocations;
+	struct timespec stop;
+	double ns;
+
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+
+	ns = (stop.tv_sec - measure->start.tv_sec) * 1e9 +
+				(stop.tv_nsec - measure->start.tv_nsec);
+
+	printf("  %-32s N=%-5u %12.1f ns/op %10.2f allocs/op\n",
+				name, n, ns / ops, (double) allocs / ops);
+}
+
+static bool count_entry_cb(DBusMessageIter *iter, void *user_data)
+{
+	unsigned int *count = user_data;
+
+	(*count)++;
+
+	return FALSE;
+}
+
+static bool find_nameservers_cb(DBusMessageIter *iter, void *user_data)
+{
+	DBusMessageIter *value = user_data;
+	const char *name;
+
+	dbus_message_iter_get_basic(iter, &name);
+	if (strcmp(name, "Nameservers") != 0)
+		return FALSE;
+
+	dbus_message_iter_next(iter);
+	*value = *iter;
+
+	return TRUE;
+}
+
+static void count_property(const char *path, const char *name,
+				const struct connman_value *value, void *user_data)
+{
+	unsigned int *count = user_data;
+
+	(*count)++;
+}
+
+static const struct connman_service_visitor counting_visitor = {
+	.property = count_property,
+};
+
+static const struct cui_dbus_key strength_key = CUI_DBUS_KEY("Strength");
+
+static void run(unsigned int n, unsigned int rounds)
+{
+	DBusMessageIter *dicts, *arrays;
+	struct connman_ipv4 ipv4_config;
+	DBusMessage *reply, **signals;
+	struct measure measure;
+	struct rusage usage;
+	unsigned int i, r, count;
+	const char **paths;
+	uint8_t strength;
+
+	dicts = g_new0(DBusMessageIter, n);
+	arrays = g_new0(DBusMessageIter, n);
+	paths = g_new0(const char *, n);
+	signals = g_new0(DBusMessage *, n);
+
+	measure_start(&measure);
+	for (r = 0; r < rounds; r++) {
+		reply = new_get_services_reply(n);
+		dbus_message_unref(reply);
+	}
+	measure_stop(&measure, "encode GetServices (per service)",
+							n, rounds * n);
+
+	reply = new_get_services_reply(n);
+	get_service_dicts(reply, dicts, paths);
+
+	measure_start(&measure);
+	for (r = 0; r < rounds; r++) {
+		for (i = 0, count = 0; i < n; i++) {
+			DBusMessageIter dict = dicts[i];
+
+			cui_dbus_foreach_dict_entry(&dict,
+						count_entry_cb, &count);
+		}
+	}
+	measure_stop(&measure, "cui_dbus_foreach_dict_entry", n, rounds * n);
+
+	measure_start(&measure);
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < n; i++) {
+			DBusMessageIter dict = dicts[i];
+
+			cui_dbus_get_dict_entry_key(&dict, &strength_key,
+						CUI_DBUS_ENTRY_BASIC,
+						DBUS_TYPE_BYTE, NULL, &strength);
+		}
+	}
+	measure_stop(&measure, "cui_dbus_get_dict_entry", n, rounds * n);
+
+	for (i = 0; i < n; i++) {
+		DBusMessageIter dict = dicts[i];
+
+		cui_dbus_foreach_dict_entry(&dict, find_nameservers_cb,
+								&arrays[i]);
+	}
+
+	measure_start(&measure);
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < n; i++) {
+			char **array;
+			int length;
+
+			cui_dbus_get_array(&arrays[i], DBUS_TYPE_STRING,
+							&length, &array);
+			free(array);
+		}
+	}
+	measure_stop(&measure, "cui_dbus_get_array", n, rounds * n);
+
+	measure_start(&measure);
+	for (r = 0; r < rounds; r++) {
+		DBusMessageIter iter;
+
+		count = 0;
+
+		dbus_message_iter_init(reply, &iter);
+		walk_services(&iter, &counting_visitor, &count);
+	}
+	measure_stop(&measure, "visit GetServices (per service)",
+							n, rounds * n);
+
+	measure_start(&measure);
+	for (r = 0; r < rounds; r++) {
+		connman_service_free_services_list();
+
+		for (i = 0; i < n; i++) {
+			DBusMessageIter dict = dicts[i];
+
+			update_or_create_service(reply, paths[i], &dict);
+		}
+	}
+	measure_stop(&measure, "update_or_create_service (new)",
+							n, rounds * n);
+
+	measure_start(&measure);
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < n; i++) {
+			DBusMessageIter dict = dicts[i];
+
+			update_or_create_service(reply, paths[i], &dict);
+		}
+	}
+	measure_stop(&measure, "update_or_create_service (update)",
+							n, rounds * n);
+
+	for (i = 0; i < n; i++)
+		signals[i] = new_property_changed(paths[i], i % 100);
+
+	measure_start(&measure);
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < n; i++)
+			property_changed_signal_cb(NULL, signals[i], NULL);
+	}
+	measure_stop(&measure, "PropertyChanged", n, rounds * n);
+
+	measure_start(&measure);
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < n; i++) {
+			gboolean autoconnect = (i + r) % 2;
+
+			set_service_property(get_service(paths[i]),
+					SERVICE_AUTOCONNECT,
+					DBUS_TYPE_BOOLEAN, &autoconnect);
+		}
+	}
+	measure_stop(&measure, "set_service_property (basic)",
+							n, rounds * n);
+
+	ipv4_config.method = (char *) "manual";
+	ipv4_config.address = (char *) "10.0.0.2";
+	ipv4_config.netmask = (char *) "255.0.0.0";
+	ipv4_config.gateway = (char *) "10.0.0.1";
+
+	measure_start(&measure);
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < n; i++)
+			set_service_property(get_service(paths[i]),
+					SERVICE_IPv4_CONFIGURATION,
+					DBUS_TYPE_INVALID, &ipv4_config);
+	}
+	measure_stop(&measure, "set_service_property (dict)",
+							n, rounds * n);
+
+	getrusage(RUSAGE_SELF, &usage);
+	printf("  peak RSS: %ld kB\n", usage.ru_maxrss);
+
+	for (i = 0; i < n; i++)
+		dbus_message_unref(signals[i]);
+
+	connman_service_free_services_list();
+	dbus_message_unref(reply);
+
+	g_free(signals);
+	g_free(paths);
+	g_free(arrays);
+	g_free(dicts);
+}
+
+static DBusConnection *open_private_connection(DBusServer **server)
+{
+	DBusConnection *connection;
+	char *address;
+
+	*server = dbus_server_listen("unix:tmpdir=/tmp", NULL);
+	if (*server == NULL)
+		return NULL;
+
+	address = dbus_server_get_address(*server);
+	connection = dbus_connection_open_private(address, NULL);
+	dbus_free(address);
+
+	return connection;
+}
+
+int main(int argc, char *argv[])
+{
+	static const unsigned int sizes[] = { 10, 100, 1000, 5000 };
+	DBusConnection *connection;
+	DBusServer *server;
+	unsigned int i;
+	int arg;
+
+	for (arg = 1; arg < argc; arg++) {
+		if (strcmp(argv[arg], "--borrowed") == 0)
+			connman_service_set_borrowed_strings(TRUE);
+		else if (strcmp(argv[arg], "--lazy") == 0)
+			connman_service_set_lazy_decoding(TRUE);
+	}
+
+	connection = open_private_connection(&server);
+	if (connection == NULL) {
+		fprintf(stderr, "Could not open a private connection\n");
+		return EXIT_FAILURE;
+	}
+
+	connman = g_try_malloc0(sizeof(struct connman_interface));
+	if (connman == NULL)
+		return EXIT_FAILURE;
+
+	connman->dbus_cnx = connection;
+
+	bench_paths = g_new0(char *, sizes[G_N_ELEMENTS(sizes) - 1]);
+	for (i = 0; i < sizes[G_N_ELEMENTS(sizes) - 1]; i++)
+		bench_paths[i] = g_strdup_printf(BENCH_PATH_FORMAT, i);
+
+	for (i = 0; i < G_N_ELEMENTS(sizes); i++) {
+		unsigned int rounds = 20000 / sizes[i];
+		int status;
+		pid_t pid;
+
+		fflush(stdout);
+
+		pid = fork();
+		if (pid < 0)
+			return EXIT_FAILURE;
+
+		if (pid == 0) {
+			if (connman_service_init() < 0)
+				_exit(EXIT_FAILURE);
+
+			printf("N = %u (%u rounds)\n", sizes[i],
+						rounds > 0 ? rounds : 1);
+			run(sizes[i], rounds > 0 ? rounds : 1);
+
+			fflush(stdout);
+			_exit(EXIT_SUCCESS);
+		}
+
+		if (waitpid(pid, &status, 0) < 0 || WIFEXITED(status) == 0 ||
+					WEXITSTATUS(status) != EXIT_SUCCESS)
+			return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -133,6 +133,38 @@ struct agent_input_data {
 	const char *previous_wpspin;
 };
 
+struct previous_passphrase {
+	const char *type;
+	const char *value;
+};
+
+static const struct cui_dbus_dict_spec previous_passphrase_spec[] = {
+	CUI_DBUS_DICT_BASIC("Type", DBUS_TYPE_STRING,
+				struct previous_passphrase, type),
+	CUI_DBUS_DICT_BASIC("Value", DBUS_TYPE_STRING,
+				struct previous_passphrase, value),
+	CUI_DBUS_DICT_SPEC_END,
+};
+
+enum agent_input_field {
+	AGENT_INPUT_PASSPHRASE          = 0,
+	AGENT_INPUT_WPS                 = 1,
+	AGENT_INPUT_NAME                = 2,
+	AGENT_INPUT_IDENTITY            = 3,
+	AGENT_INPUT_USERNAME            = 4,
+	AGENT_INPUT_PREVIOUS_PASSPHRASE = 5,
+};
+
+static const struct cui_dbus_key agent_input_fields[] = {
+	CUI_DBUS_KEY("Passphrase"),
+	CUI_DBUS_KEY("WPS"),
+	CUI_DBUS_KEY("Name"),
+	CUI_DBUS_KEY("Identity"),
+	CUI_DBUS_KEY("Username"),
+	CUI_DBUS_KEY("PreviousPassphrase"),
+	CUI_DBUS_KEY_END,
+};
+
 static bool parse_input_request(DBusMessageIter *arg, void *user_data)
 {
 	struct agent_input_data *data = user_data;
@@ -143,33 +175,43 @@ static bool parse_input_request(DBusMessageIter *arg, void *user_data)
 
 	dbus_message_iter_next(arg);
 
-	if (g_strcmp0(name, "Passphrase") == 0)
+	switch (cui_dbus_key_find(agent_input_fields, name)) {
+	case AGENT_INPUT_PASSPHRASE:
 		data->passphrase = TRUE;
-	else if (g_strcmp0(name, "WPS") == 0)
+		break;
+	case AGENT_INPUT_WPS:
 		data->wpspin = TRUE;
-	else if (g_strcmp0(name, "Name") == 0)
+		break;
+	case AGENT_INPUT_NAME:
 		data->hidden = TRUE;
-	else if (g_strcmp0(name, "Identity") == 0)
+		break;
+	case AGENT_INPUT_IDENTITY:
 		data->identity = TRUE;
-	else if (g_strcmp0(name, "Username") == 0)
+		break;
+	case AGENT_INPUT_USERNAME:
 		data->login = TRUE;
-	else if (g_strcmp0(name, "PreviousPassphrase") == 0) {
+		break;
+	case AGENT_INPUT_PREVIOUS_PASSPHRASE: {
+		struct previous_passphrase previous;
 		DBusMessageIter dict;
-		const char **value;
-		const char *type;
+		uint32_t found;
 
-		dbus_message_iter_recurse(arg, &dict);
+		memset(&previous, 0, sizeof(struct previous_passphrase));
 
-		cui_dbus_get_dict_entry_basic(&dict,
-					"Type", DBUS_TYPE_STRING, &type);
+		dbus_message_iter_recurse(arg, &dict);
 
-		if (g_strcmp0(type, "psk") == 0)
-			value = &data->previous_passphrase;
-		else if (g_strcmp0(type, "wpspin") == 0)
-			value = &data->previous_wpspin;
+		if (cui_dbus_get_dict(&dict, previous_passphrase_spec,
+						&previous, &found) < 0)
+			return FALSE;
 
-		cui_dbus_get_dict_entry_basic(&dict,
-					"Value", DBUS_TYPE_STRING, &value);
+		if (g_strcmp0(previous.type, "psk") == 0)
+			data->previous_passphrase = previous.value;
+		else if (g_strcmp0(previous.type, "wpspin") == 0)
+			data->previous_wpspin = previous.value;
+		break;
+	}
+	default:
+		break;
 	}
 
 	return FALSE;
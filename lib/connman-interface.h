@@ -41,23 +41,84 @@ enum connman_state {
 	CONNMAN_STATE_FAILURE = 5,
 };
 
+enum connman_tech_type {
+	CONNMAN_TECH_TYPE_UNKNOWN   = 0,
+	CONNMAN_TECH_TYPE_ETHERNET  = 1,
+	CONNMAN_TECH_TYPE_WIFI      = 2,
+	CONNMAN_TECH_TYPE_WIMAX     = 3,
+	CONNMAN_TECH_TYPE_BLUETOOTH = 4,
+	CONNMAN_TECH_TYPE_CELLULAR  = 5,
+	CONNMAN_TECH_TYPE_GPS       = 6,
+	CONNMAN_TECH_TYPE_VPN       = 7,
+	CONNMAN_TECH_TYPE_GADGET    = 8,
+	CONNMAN_TECH_TYPE_P2P       = 9,
+	CONNMAN_TECH_TYPE_MAX       = 10,
+};
+
+/* Service properties which ConnMan reports as changed */
+enum connman_service_field {
+	CONNMAN_SERVICE_STATE                     = 0,
+	CONNMAN_SERVICE_ERROR                     = 1,
+	CONNMAN_SERVICE_STRENGTH                  = 2,
+	CONNMAN_SERVICE_FAVORITE                  = 3,
+	CONNMAN_SERVICE_AUTOCONNECT               = 4,
+	CONNMAN_SERVICE_ROAMING                   = 5,
+	CONNMAN_SERVICE_NAMESERVERS               = 6,
+	CONNMAN_SERVICE_NAMESERVERS_CONFIGURATION = 7,
+	CONNMAN_SERVICE_TIMESERVERS               = 8,
+	CONNMAN_SERVICE_TIMESERVERS_CONFIGURATION = 9,
+	CONNMAN_SERVICE_DOMAINS                   = 10,
+	CONNMAN_SERVICE_DOMAINS_CONFIGURATION     = 11,
+	CONNMAN_SERVICE_IPv4                      = 12,
+	CONNMAN_SERVICE_IPv4_CONFIGURATION        = 13,
+	CONNMAN_SERVICE_IPv6                      = 14,
+	CONNMAN_SERVICE_IPv6_CONFIGURATION        = 15,
+	CONNMAN_SERVICE_PROXY                     = 16,
+	CONNMAN_SERVICE_PROXY_CONFIGURATION       = 17,
+	CONNMAN_SERVICE_PROVIDER                  = 18,
+	CONNMAN_SERVICE_ETHERNET                  = 19,
+	CONNMAN_SERVICE_MAX                       = 20,
+	/* Only known from the services list */
+	CONNMAN_SERVICE_NAME                      = 21,
+	CONNMAN_SERVICE_TYPE                      = 22,
+	CONNMAN_SERVICE_SECURITY                  = 23,
+	CONNMAN_SERVICE_IMMUTABLE                 = 24,
+};
+
+#define CONNMAN_SERVICE_MASK(field) (1U << (field))
+
+enum connman_technology_field {
+	CONNMAN_TECHNOLOGY_POWERED              = 0,
+	CONNMAN_TECHNOLOGY_CONNECTED            = 1,
+	CONNMAN_TECHNOLOGY_TETHERING            = 2,
+	CONNMAN_TECHNOLOGY_TETHERING_IDENTIFIER = 3,
+	CONNMAN_TECHNOLOGY_TETHERING_PASSPHRASE = 4,
+	CONNMAN_TECHNOLOGY_MAX                  = 5,
+	/* Only known from the technologies list */
+	CONNMAN_TECHNOLOGY_NAME                 = 6,
+	CONNMAN_TECHNOLOGY_TYPE                 = 7,
+};
+
+#define CONNMAN_TECHNOLOGY_MASK(field) (1U << (field))
+
+/* Fields marked as interned are connman_intern() pointers */
 struct connman_ipv4 {
-	char *method;
+	char *method;		/* interned */
 	char *address;
 	char *netmask;
 	char *gateway;
 };
 
 struct connman_ipv6 {
-	char *method;
+	char *method;		/* interned */
 	char *address;
 	uint8_t prefix;
 	char *gateway;
-	char *privacy;
+	char *privacy;		/* interned */
 };
 
 struct connman_proxy {
-	char *method;
+	char *method;		/* interned */
 	char *url;
 	char *servers;
 	char *excludes;
@@ -67,16 +128,131 @@ struct connman_provider {
 	char *host;
 	char *domain;
 	char *name;
-	char *type;
+	char *type;		/* interned */
 };
 
 struct connman_ethernet {
-	char *method;
+	char *method;		/* interned */
 	char *interface;
 	char *address;
 	uint16_t mtu;
 	uint16_t speed;
-	char *duplex;
+	char *duplex;		/* interned */
+};
+
+/*
+ * Filled by connman_service_get_snapshot(): only the fields asked for
+ * are set, the others are left zeroed. Pointers belong to the service.
+ */
+struct connman_service_info {
+	const char *path;
+	const char *name;
+	const char *type;
+	enum connman_tech_type type_id;	/* set along with type */
+	const char *security;
+	enum connman_state state;
+	const char *error;
+	uint8_t strength;
+
+	gboolean favorite;
+	gboolean immutable;
+	gboolean autoconnect;
+	gboolean roaming;
+
+	const char *nameservers;
+	const char *nameservers_conf;
+	const char *timeservers;
+	const char *timeservers_conf;
+	const char *domains;
+	const char *domains_conf;
+
+	const struct connman_ipv4 *ipv4;
+	const struct connman_ipv4 *ipv4_conf;
+	const struct connman_ipv6 *ipv6;
+	const struct connman_ipv6 *ipv6_conf;
+	const struct connman_proxy *proxy;
+	const struct connman_proxy *proxy_conf;
+	const struct connman_provider *provider;
+	const struct connman_ethernet *ethernet;
+};
+
+/* Values for connman_service_apply(), only read for the fields applied */
+struct connman_service_config {
+	const struct connman_ipv4 *ipv4;
+	const struct connman_ipv6 *ipv6;
+	const struct connman_proxy *proxy;
+	const char *nameservers;	/* ';' separated */
+	const char *domains;		/* ';' separated */
+	const char *timeservers;	/* ';' separated */
+};
+
+/* States a service goes through once asked to connect */
+enum connman_connect_step {
+	CONNMAN_CONNECT_ASSOCIATION   = 0,
+	CONNMAN_CONNECT_CONFIGURATION = 1,
+	CONNMAN_CONNECT_READY         = 2,
+	CONNMAN_CONNECT_ONLINE        = 3,
+	CONNMAN_CONNECT_FAILURE       = 4,
+	CONNMAN_CONNECT_STEP_MAX      = 5,
+};
+
+/*
+ * One connection attempt: steps are in microseconds since the connect
+ * call, 0 for those not reached.
+ */
+struct connman_connect_timeline {
+	int64_t started;	/* g_get_monotonic_time() */
+	int64_t step[CONNMAN_CONNECT_STEP_MAX];
+	const char *error;	/* interned, NULL if none */
+	gboolean finished;
+};
+
+/* In milliseconds, accurate to 1/8th of the value */
+struct connman_latency {
+	unsigned int count;
+	uint32_t p50;
+	uint32_t p95;
+	uint32_t p99;
+};
+
+struct connman_connect_stats {
+	unsigned int attempts;
+	unsigned int failures;
+	struct connman_latency ready;
+	struct connman_latency online;
+};
+
+enum connman_value_type {
+	CONNMAN_VALUE_BOOLEAN      = 0,
+	CONNMAN_VALUE_BYTE         = 1,
+	CONNMAN_VALUE_UINT16       = 2,
+	CONNMAN_VALUE_INT32        = 3,
+	CONNMAN_VALUE_UINT32       = 4,
+	CONNMAN_VALUE_STRING       = 5,
+	CONNMAN_VALUE_STRING_ARRAY = 6,
+};
+
+/* A property value, only valid during the callback it is given to */
+struct connman_value {
+	enum connman_value_type type;
+	union {
+		gboolean boolean;
+		uint8_t byte;
+		uint16_t uint16;
+		int32_t int32;
+		uint32_t uint32;
+		const char *string;
+	} data;
+	const void *array;	/* private */
+};
+
+/* Outcome of an asynchronous method call, only valid during its callback */
+struct connman_reply {
+	const char *path;
+	const char *method;	/* interned */
+	int error;		/* -ETIMEDOUT if no reply came in time */
+	const char *error_name;	/* D-Bus error name, NULL on success */
+	int64_t latency;	/* in microseconds, from sending to reply */
 };
 
 typedef void (*connman_interface_cb_f)(void *user_data);
@@ -89,7 +265,22 @@ typedef void (*connman_property_set_cb_f)(const char *path,
 						const char *property,
 						int error,
 						void *user_data);
+typedef void (*connman_property_applied_cb_f)(const char *path,
+					const char *property,
+					const struct connman_value *value,
+					int error,
+					void *user_data);
 typedef void (*connman_path_changed_cb_f)(const char *path);
+typedef void (*connman_service_changed_cb_f)(const char *path,
+						uint32_t changed,
+						void *user_data);
+typedef void (*connman_service_apply_cb_f)(const char *path,
+						uint32_t applied,
+						uint32_t failed,
+						const int *errors,
+						void *user_data);
+typedef void (*connman_reply_cb_f)(const struct connman_reply *reply,
+						void *user_data);
 
 typedef void (*agent_error_cb_f)(const char *path, const char *error);
 typedef void (*agent_browser_cb_f)(const char *path, const char *url);
@@ -109,6 +300,25 @@ int connman_interface_init(connman_interface_cb_f interface_connected_cb,
 
 void connman_interface_finalize(void);
 
+/*
+ * Returns the canonical pointer for string. Values documented as
+ * interned can be compared by identity against such a pointer.
+ */
+const char *connman_intern(const char *string);
+
+/*
+ * Grows each time a service or technology field changes: remember it
+ * before looking at them to ask later what changed since.
+ */
+uint32_t connman_get_generation(void);
+
+/*
+ * The *_async() calls return a request id, or 0 if they could not be
+ * sent, and call back once with the reply. A timeout below 0 is D-Bus's
+ * default one. A cancelled request is not called back.
+ */
+int connman_request_cancel(guint id);
+
 
 /**************\
 * Manager part *
@@ -124,6 +334,12 @@ enum connman_state connman_manager_get_state(void);
 gboolean connman_manager_get_offlinemode(void);
 
 void connman_manager_register_agent(const char *path);
+guint connman_manager_set_offlinemode_async(gboolean offlinemode,
+				int timeout, connman_reply_cb_f callback,
+				void *user_data);
+guint connman_manager_register_agent_async(const char *path,
+				int timeout, connman_reply_cb_f callback,
+				void *user_data);
 void connman_manager_unregister_agent(const char *path);
 
 /*****************\
@@ -133,6 +349,15 @@ void connman_manager_unregister_agent(const char *path);
 int connman_technology_init(void);
 void connman_technology_finalize(void);
 
+void connman_technology_set_borrowed_strings(gboolean enable);
+
+/*
+ * Scans completed less than seconds ago are not run again: the scan
+ * callback is then called from the main loop. Scans asked for while one
+ * is running are merged into it. The default, 0, always scans.
+ */
+void connman_technology_set_scan_max_age(unsigned int seconds);
+
 void connman_technology_set_global_property_callback(
 			connman_property_changed_cb_f property_changed_cb,
 			void *user_data);
@@ -142,6 +367,16 @@ void connman_technology_set_property_changed_callback(const char *path,
 void connman_technology_set_property_error_callback(const char *path,
 				connman_property_set_cb_f property_set_cb,
 				void *user_data);
+/*
+ * Setting a property while it is being set only keeps the last value,
+ * sent once the pending call replies. Completion is reported for that
+ * last value only, from its reply: value is that one, NULL for a
+ * dictionary, and error 0 or a negative errno. The error callback keeps
+ * being called, from the main loop, on failures only.
+ */
+void connman_technology_set_property_applied_callback(const char *path,
+			connman_property_applied_cb_f property_applied_cb,
+			void *user_data);
 void connman_technology_set_removed_callback(
 					connman_path_changed_cb_f removed_cb);
 void connman_technology_set_added_callback(connman_path_changed_cb_f added_cb);
@@ -157,12 +392,19 @@ int connman_technology_set_tethering_identifier(const char *path,
 int connman_technology_set_tethering_passphrase(const char *path,
 						const char *passphrase);
 
+/* Name and type are interned */
 const char *connman_technology_get_name(const char *path);
 const char *connman_technology_get_type(const char *path);
+enum connman_tech_type connman_technology_get_type_id(const char *path);
+/* Path of the technology of that type, if any */
+const char *connman_technology_find_by_type(enum connman_tech_type type);
 gboolean connman_technology_is_enabled(const char *path);
 gboolean connman_technology_is_tethering(const char *path);
 const char *connman_technology_get_tethering_identifier(const char *path);
 const char *connman_technology_get_tethering_passphrase(const char *path);
+/* As connman_service_changed_since(), with CONNMAN_TECHNOLOGY_MASK() bits */
+gboolean connman_technology_changed_since(const char *path,
+				uint32_t generation, uint32_t *changed);
 
 
 /**************\
@@ -172,21 +414,92 @@ const char *connman_technology_get_tethering_passphrase(const char *path);
 int connman_service_init(void);
 void connman_service_finalize(void);
 
+/*
+ * When enabled, string properties point into the last D-Bus message
+ * which carried them instead of being copied. Such a message is kept
+ * until all the values it backs have been updated. Returned strings
+ * stay valid until their property changes, as in the default mode.
+ */
+void connman_service_set_borrowed_strings(gboolean enable);
+
+/*
+ * When enabled before connman_service_init(), services are fetched at
+ * once and kept up to date until connman_service_finalize(): freeing
+ * the services list only drops the refresh callbacks, and refreshing
+ * it reports the known services before fetching them again.
+ */
+void connman_service_set_cache_mode(gboolean enable);
+
+/*
+ * When enabled, the addresses, servers, proxy, provider and ethernet
+ * settings of the services list are only decoded once read: the list
+ * message is kept until then.
+ */
+void connman_service_set_lazy_decoding(gboolean enable);
+
 int connman_service_refresh_services_list(connman_refresh_cb_f refresh_cb,
 				connman_scan_cb_f scan_cb, void *user_data);
 GSList *connman_service_get_services(void);
+
+/*
+ * Returns the paths of the services in ConnMan's order without copying
+ * them. They stay valid until the list is refreshed or freed.
+ */
+const char **connman_service_borrow_services(unsigned int *length);
+int connman_service_get_position(const char *path);
+
 void connman_service_free_services_list(void);
+
+/*
+ * Walks a GetServices reply once, without building the service list:
+ * connman_service_init() is not needed. Entries of dictionaries are
+ * given flattened, as "IPv4.Address" for instance. Returning FALSE from
+ * service skips the properties of that service. done is called last,
+ * with a negative error if the reply could not be walked. A new visit
+ * or a NULL visitor cancels the pending one.
+ */
+struct connman_service_visitor {
+	gboolean (*service)(const char *path, void *user_data);
+	void (*property)(const char *path, const char *name,
+				const struct connman_value *value,
+				void *user_data);
+	void (*done)(int error, void *user_data);
+};
+
+int connman_service_visit_services(const struct connman_service_visitor *visitor,
+							void *user_data);
+
+/*
+ * Joins a CONNMAN_VALUE_STRING_ARRAY value into buffer, and returns
+ * the length it needs as snprintf() does.
+ */
+int connman_value_join_strings(const struct connman_value *value,
+				char separator, char *buffer, size_t size);
+/*
+ * Changes are reported once per main loop iteration and service, as a
+ * mask of CONNMAN_SERVICE_MASK() bits, before the per property callback
+ * of the service is called for each of them.
+ */
+void connman_service_set_changed_callback(
+			connman_service_changed_cb_f changed_cb,
+			void *user_data);
 void connman_service_set_property_changed_callback(const char *path,
 			connman_property_changed_cb_f property_changed_cb,
 			void *user_data);
 void connman_service_set_property_error_callback(const char *path,
 				connman_property_set_cb_f property_set_cb,
 				void *user_data);
+/* As connman_technology_set_property_applied_callback() */
+void connman_service_set_property_applied_callback(const char *path,
+			connman_property_applied_cb_f property_applied_cb,
+			void *user_data);
 void connman_service_set_removed_callback(
 				connman_path_changed_cb_f removed_cb);
 
 const char *connman_service_get_name(const char *path);
+/* Type and security are interned */
 const char *connman_service_get_type(const char *path);
+enum connman_tech_type connman_service_get_type_id(const char *path);
 enum connman_state connman_service_get_state(const char *path);
 const char *connman_service_get_error(const char *path);
 const char *connman_service_get_security(const char *path);
@@ -212,12 +525,94 @@ const struct connman_ethernet *connman_service_get_ethernet(const char *path);
 
 gboolean connman_service_is_connected(const char *path);
 
+/*
+ * A handle keeps its service alive, though no longer updated, once
+ * it has been removed: it spares the path lookup of each getter.
+ */
+typedef struct connman_service connman_service_t;
+
+connman_service_t *connman_service_ref(const char *path);
+void connman_service_unref(connman_service_t *service);
+
+const char *connman_service_handle_get_path(const connman_service_t *service);
+const char *connman_service_handle_get_name(const connman_service_t *service);
+const char *connman_service_handle_get_type(const connman_service_t *service);
+enum connman_tech_type connman_service_handle_get_type_id(
+					const connman_service_t *service);
+enum connman_state connman_service_handle_get_state(
+					const connman_service_t *service);
+const char *connman_service_handle_get_error(const connman_service_t *service);
+const char *connman_service_handle_get_security(
+					const connman_service_t *service);
+uint8_t connman_service_handle_get_strength(const connman_service_t *service);
+gboolean connman_service_handle_is_favorite(const connman_service_t *service);
+gboolean connman_service_handle_is_immutable(const connman_service_t *service);
+gboolean connman_service_handle_is_autoconnect(
+					const connman_service_t *service);
+gboolean connman_service_handle_is_roaming(const connman_service_t *service);
+const char *connman_service_handle_get_nameservers(
+					const connman_service_t *service);
+const char *connman_service_handle_get_nameservers_config(
+					const connman_service_t *service);
+const char *connman_service_handle_get_domains(
+					const connman_service_t *service);
+const char *connman_service_handle_get_domains_config(
+					const connman_service_t *service);
+const char *connman_service_handle_get_timeservers(
+					const connman_service_t *service);
+const char *connman_service_handle_get_timeservers_config(
+					const connman_service_t *service);
+const struct connman_ipv4 *connman_service_handle_get_ipv4(
+					const connman_service_t *service);
+const struct connman_ipv4 *connman_service_handle_get_ipv4_config(
+					const connman_service_t *service);
+const struct connman_ipv6 *connman_service_handle_get_ipv6(
+					const connman_service_t *service);
+const struct connman_ipv6 *connman_service_handle_get_ipv6_config(
+					const connman_service_t *service);
+const struct connman_proxy *connman_service_handle_get_proxy(
+					const connman_service_t *service);
+const struct connman_proxy *connman_service_handle_get_proxy_config(
+					const connman_service_t *service);
+const struct connman_provider *connman_service_handle_get_provider(
+					const connman_service_t *service);
+const struct connman_ethernet *connman_service_handle_get_ethernet(
+					const connman_service_t *service);
+gboolean connman_service_handle_is_connected(const connman_service_t *service);
+
+/*
+ * Fills info with the fields of the mask of CONNMAN_SERVICE_MASK() bits,
+ * and returns their generation: it grows whenever one of them is updated,
+ * and is 0 for an unknown service.
+ */
+uint32_t connman_service_get_snapshot(const char *path,
+			struct connman_service_info *info, uint32_t fields);
+uint32_t connman_service_handle_get_snapshot(const connman_service_t *service,
+			struct connman_service_info *info, uint32_t fields);
+
+/*
+ * Tells whether a field of the service was updated after generation,
+ * and sets changed, if not NULL, to the CONNMAN_SERVICE_MASK() bits of
+ * those fields. With lazy decoding, a dictionary field is only known to
+ * have changed once read.
+ */
+gboolean connman_service_changed_since(const char *path,
+				uint32_t generation, uint32_t *changed);
+gboolean connman_service_handle_changed_since(const connman_service_t *service,
+				uint32_t generation, uint32_t *changed);
+
 int connman_service_select(const char *path);
 void connman_service_deselect(void);
 
 int connman_service_connect(const char *path);
 int connman_service_disconnect(const char *path);
 int connman_service_remove(const char *path);
+guint connman_service_connect_async(const char *path, int timeout,
+			connman_reply_cb_f callback, void *user_data);
+guint connman_service_disconnect_async(const char *path, int timeout,
+			connman_reply_cb_f callback, void *user_data);
+guint connman_service_remove_async(const char *path, int timeout,
+			connman_reply_cb_f callback, void *user_data);
 int connman_service_set_autoconnectable(const char *path, gboolean enable);
 int connman_service_set_ipv4_config(const char *path,
 				const struct connman_ipv4 *ipv4_config);
@@ -232,6 +627,33 @@ int connman_service_set_domains_config(const char *path,
 int connman_service_set_timeservers_config(const char *path,
 					const char *timeservers_config);
 
+/*
+ * Sets all the *_CONFIGURATION fields of mask at once, superseding the
+ * values still pending from the single setters, which are reported as
+ * applied with -ECANCELED. done_cb is called a single time, when all of
+ * them got their reply, with the fields that were sent and those among
+ * them which failed; errors, indexed by field, holds the -errno of each
+ * failed one. connman_service_finalize() fails the pending fields with
+ * -ECANCELED.
+ */
+int connman_service_apply(const char *path,
+			const struct connman_service_config *config,
+			uint32_t mask, connman_service_apply_cb_f done_cb,
+			void *user_data);
+
+/*
+ * Each connman_service_connect() or connman_service_connect_async() call
+ * starts an attempt, followed through the State changes until the service
+ * is ready (or online, if it goes on) or until it fails, or until an async
+ * Connect call does. The last ones are kept per service: up to max of them
+ * are copied, the latest first, and their count is returned. Times to ready and online are aggregated by type.
+ */
+int connman_service_get_connect_timeline(const char *path,
+				struct connman_connect_timeline *timeline,
+				int max);
+int connman_service_get_connect_stats(enum connman_tech_type type,
+				struct connman_connect_stats *stats);
+
 /************\
 * Agent part *
 \************/
@@ -22,6 +22,8 @@
 #ifndef __CONNMAN_PRIVATE_H__
 #define __CONNMAN_PRIVATE_H__
 
+#include <string.h>
+
 #include <connman-interface.h>
 
 #define CONNMAN_DBUS_NAME "net.connman"
@@ -51,16 +53,132 @@ struct property_setting {
 	int index;
 };
 
+/*
+ * Property names are dispatched on their length, first, fourth and last
+ * characters: this tells apart every property name ConnMan sends for a
+ * given interface, so a switch plus one strcmp() resolves a name.
+ */
+#define PROPERTY_KEY(length, first, fourth, last)			\
+	(((length) << 24) | ((first) << 16) | ((fourth) << 8) | (last))
+
+static inline unsigned int property_key(const char *name)
+{
+	size_t length;
+
+	if (name == NULL)
+		return 0;
+
+	length = strlen(name);
+	if (length < 4 || length > 255)
+		return 0;
+
+	return PROPERTY_KEY(length, (unsigned char) name[0],
+				(unsigned char) name[3],
+				(unsigned char) name[length - 1]);
+}
+
+/*
+ * A borrowed string points into the message held by its backing slot.
+ * Switching the slot to another message, or to NULL once the string is
+ * an allocated copy again, releases the previous one.
+ */
+static inline void set_backing(DBusMessage **backing, DBusMessage *message)
+{
+	if (message != NULL)
+		dbus_message_ref(message);
+
+	if (*backing != NULL)
+		dbus_message_unref(*backing);
+
+	*backing = message;
+}
+
+static inline char *update_string(char *previous, const char *value,
+				DBusMessage **backing, DBusMessage *message)
+{
+	if (*backing == NULL)
+		g_free(previous);
+
+	set_backing(backing, message);
+
+	if (message != NULL)
+		return (char *) value;
+
+	return g_strdup(value);
+}
+
+/*
+ * Drops the slots of the first length entries of a dirty queue which were
+ * flushed, and thus set to NULL. Callbacks run while flushing may have
+ * cleared the queue and queued objects again, these are kept.
+ */
+static inline void remove_flushed(GPtrArray *dirty, unsigned int length)
+{
+	unsigned int i, kept = 0;
+
+	length = MIN(length, dirty->len);
+
+	for (i = 0; i < dirty->len; i++) {
+		if (i < length && dirty->pdata[i] == NULL)
+			continue;
+
+		dirty->pdata[kept++] = dirty->pdata[i];
+	}
+
+	g_ptr_array_set_size(dirty, kept);
+}
+
 extern struct connman_interface *connman;
 
-typedef void (*connman_manager_get_technologies_cb_f)(DBusMessageIter *iter);
-typedef void (*connman_manager_technology_added_cb_f)(DBusMessageIter *iter);
+/* Stamp for an updated field, see connman_get_generation() */
+uint32_t __connman_generation_next(void);
+
+/*
+ * Method calls are copied from a template message built on first use,
+ * so that their header is marshalled only once per object and method.
+ * Templates are cached by path, interface, method and the signature of
+ * the body the caller appends, NULL for none. Those of an object are
+ * dropped along with it.
+ */
+DBusMessage *__connman_message_new_method_call(const char *path,
+					const char *interface,
+					const char *method,
+					const char *signature);
+void __connman_message_drop_templates(const char *path);
+
+/* Only for basic values and string arrays, as long as variant lives */
+gboolean __connman_get_value(DBusMessageIter *variant,
+					struct connman_value *value);
+
+/* D-Bus error name to negative errno, -EIO for the unknown ones */
+int __connman_error2errno(const char *name);
+
+/* message stays the caller's, see connman_request_cancel() for the rest */
+guint __connman_request_send(DBusConnection *dbus_cnx, DBusMessage *message,
+				int timeout, connman_reply_cb_f callback,
+				void *user_data);
+/* Called on the reply before the callback, never once cancelled */
+void __connman_request_set_hook(guint id, connman_reply_cb_f hook);
+
+/*
+ * The message is handed over with its iterator so that strings may be
+ * borrowed from it: callbacks keep a reference on it if they do so.
+ */
+typedef void (*connman_manager_get_technologies_cb_f)(DBusMessage *message,
+							DBusMessageIter *iter);
+typedef void (*connman_manager_technology_added_cb_f)(DBusMessage *message,
+							DBusMessageIter *iter);
 typedef void (*connman_manager_technology_removed_cb_f)(DBusMessageIter *iter);
 
-typedef void (*connman_manager_get_services_cb_f)(DBusMessageIter *iter);
-typedef void (*connman_manager_service_changed_cb)(DBusMessageIter *iter);
+typedef void (*connman_manager_get_services_cb_f)(DBusMessage *message,
+							DBusMessageIter *iter);
+typedef void (*connman_manager_service_changed_cb)(DBusMessage *message,
+							DBusMessageIter *iter);
 
 enum connman_state string2enum_state(const char *state);
+enum connman_tech_type string2enum_tech_type(const char *type);
+
+int __connman_technology_count(void);
 
 int __connman_manager_get_technologies(connman_manager_get_technologies_cb_f cb);
 
@@ -68,6 +186,7 @@ int __connman_manager_register_technology_signals(connman_manager_technology_add
 			connman_manager_technology_removed_cb_f removed_cb);
 
 int __connman_manager_get_services(connman_manager_get_services_cb_f cb);
+int __connman_manager_visit_services(connman_manager_get_services_cb_f cb);
 
 int __connman_manager_register_service_signal(connman_manager_service_changed_cb cb);
 
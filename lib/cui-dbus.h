@@ -23,6 +23,8 @@
 
 #include <dbus/dbus.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #ifndef DBUS_TIMEOUT_USE_DEFAULT
 	#define DBUS_TIMEOUT_USE_DEFAULT (-1)
@@ -38,8 +40,74 @@ enum cui_dbus_entry {
 	CUI_DBUS_ENTRY_ARRAY       = 1,
 	CUI_DBUS_ENTRY_FIXED_ARRAY = 2,
 	CUI_DBUS_ENTRY_DICT        = 3,
+	CUI_DBUS_ENTRY_JOINED      = 4,
 };
 
+/* Separator used by CUI_DBUS_ENTRY_JOINED string arrays */
+#define CUI_DBUS_JOINED_SEPARATOR ';'
+
+/*
+ * A dictionary key with its length computed once, so that lookups compare
+ * entry names to it without measuring them. CUI_DBUS_KEY() takes it from
+ * a string literal at compile time, cui_dbus_key_init() at runtime.
+ */
+struct cui_dbus_key {
+	const char *name;
+	size_t length;
+};
+
+#define CUI_DBUS_KEY(key) { key, sizeof(key) - 1 }
+
+#define CUI_DBUS_KEY_END { NULL, 0 }
+
+void cui_dbus_key_init(struct cui_dbus_key *key, const char *name);
+
+/*
+ * Returns the index of name in keys, a CUI_DBUS_KEY_END terminated
+ * table, or -1 if it is not there.
+ */
+int cui_dbus_key_find(const struct cui_dbus_key *keys, const char *name);
+
+/*
+ * Hashes the value iter points to, containers included, so that two
+ * values can be told apart without decoding them. Equal values hash the
+ * same, different ones only do so with a 1 in 2^32 chance. File
+ * descriptors are not read, only their type is hashed.
+ */
+uint32_t cui_dbus_hash_value(DBusMessageIter *iter);
+
+/*
+ * Describes one key of an a{sv} dictionary for cui_dbus_get_dict().
+ * The value is stored offset bytes into the destination structure,
+ * as cui_dbus_get_dict_entry() would store it in its destination.
+ * CUI_DBUS_ENTRY_FIXED_ARRAY is not supported.
+ */
+struct cui_dbus_dict_spec {
+	struct cui_dbus_key key;
+	enum cui_dbus_entry entry_type;
+	int dbus_type;
+	size_t offset;
+};
+
+#define CUI_DBUS_DICT_SPEC(key, entry, type, structure, member) \
+	{ CUI_DBUS_KEY(key), entry, type, offsetof(structure, member) }
+
+#define CUI_DBUS_DICT_BASIC(key, type, structure, member) \
+	CUI_DBUS_DICT_SPEC(key, CUI_DBUS_ENTRY_BASIC, type, structure, member)
+
+#define CUI_DBUS_DICT_ARRAY(key, type, structure, member) \
+	CUI_DBUS_DICT_SPEC(key, CUI_DBUS_ENTRY_ARRAY, type, structure, member)
+
+#define CUI_DBUS_DICT_JOINED(key, structure, member) \
+	CUI_DBUS_DICT_SPEC(key, CUI_DBUS_ENTRY_JOINED, DBUS_TYPE_STRING, \
+							structure, member)
+
+#define CUI_DBUS_DICT_SPEC_END \
+	{ CUI_DBUS_KEY_END, CUI_DBUS_ENTRY_BASIC, 0, 0 }
+
+/* A spec table can describe at most that many keys */
+#define CUI_DBUS_DICT_SPEC_MAX 32
+
 typedef void (*cui_dbus_property_f) (DBusMessageIter *iter,
 							void *user_data);
 typedef bool (*cui_dbus_foreach_callback_f) (DBusMessageIter *iter,
@@ -75,6 +143,15 @@ void cui_dbus_append_fixed_array(DBusMessageIter *iter,
 					int length,
 					void *value);
 
+/*
+ * Appends the "sv" arguments of a SetProperty call carrying a basic
+ * value to an empty message.
+ */
+int cui_dbus_append_set_property(DBusMessage *message,
+					const char *key_name,
+					int dbus_type,
+					const void *value);
+
 /* Use preferably the inline functions below this one */
 void cui_dbus_append_dict_entry(DBusMessageIter *dict,
 				const char *key_name,
@@ -146,12 +223,44 @@ int cui_dbus_get_fixed_array(DBusMessageIter *iter,
 					int *length,
 					void *destination);
 
+/*
+ * Writes the strings of the array, separated by separator, into buffer
+ * and always NUL-terminates it when size is not 0. Like snprintf(), it
+ * returns the length the joined string needs, which can be larger than
+ * size - 1. A NULL buffer with a size of 0 only computes that length.
+ */
+int cui_dbus_join_string_array(DBusMessageIter *iter,
+					char separator,
+					char *buffer,
+					size_t size);
+
+/*
+ * Same as above, but allocates the joined string in one go. It is set
+ * to NULL if the array is empty, to "" if it only holds an empty string,
+ * and has to be freed with g_free().
+ */
+int cui_dbus_get_string_array_joined(DBusMessageIter *iter,
+					char separator,
+					char **destination);
+
 
 int cui_dbus_foreach_dict_entry(DBusMessageIter *iter,
 				cui_dbus_foreach_callback_f callback,
 				void *user_data);
 
 
+/*
+ * Looks for the entry whose name is exactly key. Prefer it to
+ * cui_dbus_get_dict_entry() with a static key when the same name is
+ * looked up repeatedly.
+ */
+int cui_dbus_get_dict_entry_key(DBusMessageIter *iter,
+					const struct cui_dbus_key *key,
+					enum cui_dbus_entry entry_type,
+					int dbus_type,
+					int *length,
+					void *destination);
+
 /* Use preferably the inline functions below this one */
 int cui_dbus_get_dict_entry(DBusMessageIter *iter,
 					const char *key_name,
@@ -160,6 +269,15 @@ int cui_dbus_get_dict_entry(DBusMessageIter *iter,
 					int *length,
 					void *destination);
 
+/*
+ * Decodes all the keys described by spec in a single pass over the
+ * dictionary. Bit n of found is set when spec[n] has been decoded.
+ */
+int cui_dbus_get_dict(DBusMessageIter *iter,
+				const struct cui_dbus_dict_spec *spec,
+				void *destination,
+				uint32_t *found);
+
 static inline
 int cui_dbus_get_dict_entry_basic(DBusMessageIter *iter,
 						const char *key_name,
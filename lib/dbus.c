@@ -21,10 +21,13 @@
 #include <cui-dbus.h>
 
 #include <errno.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
+#include <glib.h>
+
 static const char *map_basic_to_signature(int dbus_type)
 {
 	switch (dbus_type) {
@@ -208,6 +211,42 @@ void cui_dbus_append_fixed_array(DBusMessageIter *iter,
 		dbus_message_iter_close_container(iter, &variant);
 }
 
+int cui_dbus_append_set_property(DBusMessage *message,
+					const char *key_name,
+					int dbus_type,
+					const void *value)
+{
+	char signature[2] = { dbus_type, '\0' };
+	DBusMessageIter iter, variant;
+
+	if (message == NULL || key_name == NULL || value == NULL)
+		return -EINVAL;
+
+	if (dbus_type_is_basic(dbus_type) == FALSE)
+		return -EINVAL;
+
+	dbus_message_iter_init_append(message, &iter);
+
+	if (dbus_message_iter_append_basic(&iter, DBUS_TYPE_STRING,
+						&key_name) == FALSE)
+		return -ENOMEM;
+
+	if (dbus_message_iter_open_container(&iter, DBUS_TYPE_VARIANT,
+						signature, &variant) == FALSE)
+		return -ENOMEM;
+
+	if (dbus_message_iter_append_basic(&variant, dbus_type,
+							value) == FALSE) {
+		dbus_message_iter_abandon_container(&iter, &variant);
+		return -ENOMEM;
+	}
+
+	if (dbus_message_iter_close_container(&iter, &variant) == FALSE)
+		return -ENOMEM;
+
+	return 0;
+}
+
 void cui_dbus_append_dict_entry(DBusMessageIter *dict,
 				const char *key_name,
 				enum cui_dbus_entry entry_type,
@@ -279,15 +318,54 @@ int cui_dbus_get_basic_variant(DBusMessageIter *iter,
 	return 0;
 }
 
+static int recurse_array(DBusMessageIter *iter, DBusMessageIter *array)
+{
+	DBusMessageIter variant;
+
+	if (dbus_message_iter_get_arg_type(iter) == DBUS_TYPE_VARIANT) {
+		dbus_message_iter_recurse(iter, &variant);
+		iter = &variant;
+	}
+
+	if (dbus_message_iter_get_arg_type(iter) != DBUS_TYPE_ARRAY)
+		return -EINVAL;
+
+	dbus_message_iter_recurse(iter, array);
+
+	return 0;
+}
+
+static int count_array_elements(DBusMessageIter *array)
+{
+	DBusMessageIter counter = *array;
+	int count = 0;
+
+	while (dbus_message_iter_get_arg_type(&counter) != DBUS_TYPE_INVALID) {
+		count++;
+		dbus_message_iter_next(&counter);
+	}
+
+	return count;
+}
+
+static int get_array_element(DBusMessageIter *array,
+					int dbus_type, void *destination)
+{
+	if (dbus_message_iter_get_arg_type(array) == DBUS_TYPE_VARIANT)
+		return cui_dbus_get_basic_variant(array,
+						dbus_type, destination);
+
+	return cui_dbus_get_basic(array, dbus_type, destination);
+}
+
 int cui_dbus_get_array(DBusMessageIter *iter,
 					int dbus_type,
 					int *length,
 					void *destination)
 {
-	DBusMessageIter variant, array;
-	void **value_array = NULL;
-	int iteration;
-	int arg_type;
+	DBusMessageIter array;
+	char *value_array;
+	int count, i;
 	size_t size;
 
 	if (length == NULL || destination == NULL)
@@ -314,55 +392,118 @@ int cui_dbus_get_array(DBusMessageIter *iter,
 	}
 
 	*length = 0;
-	iteration = 0;
 	*((void **) destination) = NULL;
 
-	arg_type = dbus_message_iter_get_arg_type(iter);
-	if (arg_type == DBUS_TYPE_VARIANT) {
-		dbus_message_iter_recurse(iter, &variant);
-		dbus_message_iter_recurse(&variant, &array);
-	} else
-		dbus_message_iter_recurse(iter, &array);
+	if (recurse_array(iter, &array) < 0)
+		return -EINVAL;
+
+	count = count_array_elements(&array);
+	if (count == 0)
+		return 0;
+
+	/* One extra zeroed element terminates pointer arrays */
+	value_array = calloc(count + 1, size);
+	if (value_array == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < count; i++) {
+		if (get_array_element(&array, dbus_type,
+					value_array + i * size) != 0) {
+			free(value_array);
+			return -EINVAL;
+		}
+
+		dbus_message_iter_next(&array);
+	}
+
+	*length = count;
+	*((void **) destination) = value_array;
+
+	return 0;
+}
+
+int cui_dbus_join_string_array(DBusMessageIter *iter,
+					char separator,
+					char *buffer,
+					size_t size)
+{
+	DBusMessageIter array;
+	gboolean first = TRUE;
+	size_t total = 0;
+	const char *value;
+	int arg_type;
+
+	if (buffer == NULL && size != 0)
+		return -EINVAL;
+
+	if (recurse_array(iter, &array) < 0)
+		return -EINVAL;
 
 	arg_type = dbus_message_iter_get_arg_type(&array);
 	while (arg_type != DBUS_TYPE_INVALID) {
-		void **new_array;
+		size_t value_length;
 
-		iteration++;
+		if (get_array_element(&array, DBUS_TYPE_STRING, &value) != 0)
+			return -EINVAL;
 
-		new_array = realloc(value_array, size * (iteration + 1));
-		if (new_array == NULL)
-			goto error;
+		if (first == FALSE) {
+			if (total < size)
+				buffer[total] = separator;
+			total++;
+		}
+		first = FALSE;
 
-		value_array = new_array;
+		value_length = strlen(value);
+		if (total > INT_MAX || value_length > INT_MAX - total)
+			return -EOVERFLOW;
 
-		if (arg_type == DBUS_TYPE_VARIANT) {
-			if (cui_dbus_get_basic_variant(&array, dbus_type,
-						&value_array[iteration-1]) != 0)
-				goto error;
-		} else
-			dbus_message_iter_get_basic(&array,
-						&value_array[iteration-1]);
+		if (total < size)
+			memcpy(buffer + total, value,
+				total + value_length < size ?
+					value_length : size - total);
+		total += value_length;
 
 		dbus_message_iter_next(&array);
-
 		arg_type = dbus_message_iter_get_arg_type(&array);
 	}
 
-	if (iteration > 0) {
-		value_array[iteration] = NULL;
-		*length = iteration - 1;
-	}
+	if (size > 0)
+		buffer[total < size ? total : size - 1] = '\0';
 
-	*((void **) destination) = value_array;
+	return total;
+}
 
-	return 0;
+int cui_dbus_get_string_array_joined(DBusMessageIter *iter,
+					char separator,
+					char **destination)
+{
+	DBusMessageIter array;
+	int length;
 
-error:
-	if (value_array != NULL)
-		free(value_array);
+	if (destination == NULL)
+		return -EINVAL;
+
+	*destination = NULL;
+
+	length = cui_dbus_join_string_array(iter, separator, NULL, 0);
+	if (length < 0)
+		return length;
+
+	/* Only an empty array has no value, [""] is joined as "" */
+	if (length == 0) {
+		recurse_array(iter, &array);
+		if (dbus_message_iter_get_arg_type(&array) ==
+							DBUS_TYPE_INVALID)
+			return 0;
+	}
+
+	*destination = g_try_malloc(length + 1);
+	if (*destination == NULL)
+		return -ENOMEM;
+
+	cui_dbus_join_string_array(iter, separator, *destination, length + 1);
 
-	return -ENOMEM;
+	return 0;
 }
 
 int cui_dbus_get_fixed_array(DBusMessageIter *iter,
@@ -403,6 +544,12 @@ static int cui_dbus_get(DBusMessageIter *iter,
 		case CUI_DBUS_ENTRY_FIXED_ARRAY:
 			return cui_dbus_get_fixed_array(iter,
 							length, destination);
+		case CUI_DBUS_ENTRY_JOINED:
+			if (dbus_type != DBUS_TYPE_STRING)
+				return -EINVAL;
+
+			return cui_dbus_get_string_array_joined(iter,
+					CUI_DBUS_JOINED_SEPARATOR, destination);
 		case CUI_DBUS_ENTRY_DICT:
 			if (destination == NULL)
 				return -EINVAL;
@@ -450,8 +597,106 @@ int cui_dbus_foreach_dict_entry(DBusMessageIter *iter,
 	return -EINVAL;
 }
 
+/* Whether name, of unknown length, is exactly key */
+static inline bool key_equal(const struct cui_dbus_key *key, const char *name)
+{
+	if (name[0] != key->name[0])
+		return false;
+
+	return strncmp(name, key->name, key->length) == 0 &&
+						name[key->length] == '\0';
+}
+
+void cui_dbus_key_init(struct cui_dbus_key *key, const char *name)
+{
+	key->name = name;
+	key->length = name != NULL ? strlen(name) : 0;
+}
+
+int cui_dbus_key_find(const struct cui_dbus_key *keys, const char *name)
+{
+	const struct cui_dbus_key *key;
+
+	if (keys == NULL || name == NULL)
+		return -1;
+
+	for (key = keys; key->name != NULL; key++) {
+		if (key_equal(key, name) == true)
+			return key - keys;
+	}
+
+	return -1;
+}
+
+#define FNV_OFFSET 2166136261U
+#define FNV_PRIME 16777619U
+
+static uint32_t hash_bytes(uint32_t hash, const void *data, size_t length)
+{
+	const unsigned char *bytes = data;
+	size_t i;
+
+	for (i = 0; i < length; i++) {
+		hash ^= bytes[i];
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
+
+static uint32_t hash_value(uint32_t hash, DBusMessageIter *iter)
+{
+	DBusMessageIter sub;
+	dbus_uint64_t fixed = 0;
+	const char *string;
+	unsigned char type;
+
+	type = dbus_message_iter_get_arg_type(iter);
+	hash = hash_bytes(hash, &type, 1);
+
+	switch (type) {
+	case DBUS_TYPE_INVALID:
+	case DBUS_TYPE_UNIX_FD:
+		/* Getting a file descriptor would duplicate it */
+		break;
+	case DBUS_TYPE_STRING:
+	case DBUS_TYPE_OBJECT_PATH:
+	case DBUS_TYPE_SIGNATURE:
+		dbus_message_iter_get_basic(iter, &string);
+		hash = hash_bytes(hash, string, strlen(string) + 1);
+		break;
+	case DBUS_TYPE_ARRAY:
+	case DBUS_TYPE_STRUCT:
+	case DBUS_TYPE_DICT_ENTRY:
+	case DBUS_TYPE_VARIANT:
+		dbus_message_iter_recurse(iter, &sub);
+
+		while (dbus_message_iter_get_arg_type(&sub) !=
+							DBUS_TYPE_INVALID) {
+			hash = hash_value(hash, &sub);
+			dbus_message_iter_next(&sub);
+		}
+
+		/* Ends the container, so that nesting counts */
+		hash = hash_bytes(hash, &type, 1);
+		break;
+	default:
+		/* Fixed types fit in 8 bytes, the unused ones stay 0 */
+		dbus_message_iter_get_basic(iter, &fixed);
+		hash = hash_bytes(hash, &fixed, sizeof(fixed));
+		break;
+	}
+
+	return hash;
+}
+
+uint32_t cui_dbus_hash_value(DBusMessageIter *iter)
+{
+	return hash_value(FNV_OFFSET, iter);
+}
+
 struct dict_entry_parameters {
-	const char *key_name;
+	const struct cui_dbus_key *key;
 	enum cui_dbus_entry entry_type;
 	int dbus_type;
 	int *length;
@@ -466,21 +711,20 @@ static bool get_dict_entry_cb(DBusMessageIter *iter, void *user_data)
 
 	dbus_message_iter_get_basic(iter, &name);
 
-	if (strncmp(param->key_name, name, strlen(param->key_name)) == 0) {
-		dbus_message_iter_next(iter);
-		dbus_message_iter_recurse(iter, &dict_value);
+	if (key_equal(param->key, name) == false)
+		return FALSE;
 
-		cui_dbus_get(&dict_value, param->entry_type,
-			param->dbus_type, param->length, param->destination);
+	dbus_message_iter_next(iter);
+	dbus_message_iter_recurse(iter, &dict_value);
 
-		return TRUE;
-	}
+	cui_dbus_get(&dict_value, param->entry_type,
+			param->dbus_type, param->length, param->destination);
 
-	return FALSE;
+	return TRUE;
 }
 
-int cui_dbus_get_dict_entry(DBusMessageIter *iter,
-					const char *key_name,
+int cui_dbus_get_dict_entry_key(DBusMessageIter *iter,
+					const struct cui_dbus_key *key,
 					enum cui_dbus_entry entry_type,
 					int dbus_type,
 					int *length,
@@ -488,10 +732,10 @@ int cui_dbus_get_dict_entry(DBusMessageIter *iter,
 {
 	struct dict_entry_parameters param;
 
-	if (key_name == NULL)
+	if (key == NULL || key->name == NULL)
 		return -EINVAL;
 
-	param.key_name = key_name;
+	param.key = key;
 	param.entry_type = entry_type;
 	param.dbus_type = dbus_type;
 	param.length = length;
@@ -500,6 +744,105 @@ int cui_dbus_get_dict_entry(DBusMessageIter *iter,
 	return cui_dbus_foreach_dict_entry(iter, get_dict_entry_cb, &param);
 }
 
+int cui_dbus_get_dict_entry(DBusMessageIter *iter,
+					const char *key_name,
+					enum cui_dbus_entry entry_type,
+					int dbus_type,
+					int *length,
+					void *destination)
+{
+	struct cui_dbus_key key;
+
+	if (key_name == NULL)
+		return -EINVAL;
+
+	cui_dbus_key_init(&key, key_name);
+
+	return cui_dbus_get_dict_entry_key(iter, &key, entry_type,
+					dbus_type, length, destination);
+}
+
+struct dict_spec_parameters {
+	const struct cui_dbus_dict_spec *spec;
+	void *destination;
+	uint32_t found;
+	uint32_t expected;
+};
+
+static bool get_dict_spec_cb(DBusMessageIter *iter, void *user_data)
+{
+	struct dict_spec_parameters *param = user_data;
+	const struct cui_dbus_dict_spec *spec;
+	DBusMessageIter dict_value;
+	uint32_t bit;
+	char *name;
+	int length;
+
+	dbus_message_iter_get_basic(iter, &name);
+
+	for (spec = param->spec, bit = 1; spec->key.name != NULL;
+							spec++, bit <<= 1) {
+		if ((param->found & bit) != 0)
+			continue;
+
+		if (key_equal(&spec->key, name) == false)
+			continue;
+
+		dbus_message_iter_next(iter);
+		dbus_message_iter_recurse(iter, &dict_value);
+
+		if (cui_dbus_get(&dict_value, spec->entry_type,
+				spec->dbus_type, &length,
+				(char *) param->destination + spec->offset) == 0)
+			param->found |= bit;
+
+		break;
+	}
+
+	/* Stop walking as soon as everything has been found */
+	if (param->found == param->expected)
+		return TRUE;
+
+	return FALSE;
+}
+
+int cui_dbus_get_dict(DBusMessageIter *iter,
+				const struct cui_dbus_dict_spec *spec,
+				void *destination,
+				uint32_t *found)
+{
+	struct dict_spec_parameters param;
+	unsigned int count;
+
+	if (spec == NULL || destination == NULL || found == NULL)
+		return -EINVAL;
+
+	*found = 0;
+
+	for (count = 0; spec[count].key.name != NULL; count++) {
+		if (spec[count].entry_type == CUI_DBUS_ENTRY_FIXED_ARRAY)
+			return -EINVAL;
+	}
+
+	if (count == 0 || count > CUI_DBUS_DICT_SPEC_MAX)
+		return -EINVAL;
+
+	if (dbus_message_iter_get_arg_type(iter) != DBUS_TYPE_ARRAY)
+		return -EINVAL;
+
+	param.spec = spec;
+	param.destination = destination;
+	param.found = 0;
+	param.expected = count == CUI_DBUS_DICT_SPEC_MAX ?
+				0xffffffff : (1U << count) - 1;
+
+	cui_dbus_foreach_dict_entry(iter, get_dict_spec_cb, &param);
+
+	*found = param.found;
+
+	return 0;
+}
+
 int cui_dbus_get_struct_entry(DBusMessageIter *iter,
 					unsigned int position,
 					enum cui_dbus_entry entry_type,
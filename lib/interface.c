@@ -26,6 +26,22 @@
 DBusConnection *dbus_cnx_session = NULL;
 struct connman_interface *connman = NULL;
 
+struct connman_request {
+	DBusPendingCall *call;
+	char *path;
+	const char *method;
+	gint64 sent;
+
+	connman_reply_cb_f callback;
+	void *user_data;
+
+	connman_reply_cb_f hook;
+};
+
+/* Pending requests, by id */
+static GHashTable *requests = NULL;
+static guint last_request_id = 0;
+
 static void connman_watch_interface_connected(DBusConnection *dbus_cnx,
 							void *user_data)
 {
@@ -44,6 +60,330 @@ static void connman_watch_interface_disconnected(DBusConnection *dbus_cnx,
 	connman->interface_disconnected_cb(connman->user_data);
 }
 
+const char *connman_intern(const char *string)
+{
+	return g_intern_string(string);
+}
+
+gboolean __connman_get_value(DBusMessageIter *variant,
+						struct connman_value *value)
+{
+	dbus_bool_t boolean;
+
+	switch (dbus_message_iter_get_arg_type(variant)) {
+	case DBUS_TYPE_BOOLEAN:
+		dbus_message_iter_get_basic(variant, &boolean);
+		value->type = CONNMAN_VALUE_BOOLEAN;
+		value->data.boolean = boolean;
+		break;
+	case DBUS_TYPE_BYTE:
+		dbus_message_iter_get_basic(variant, &value->data.byte);
+		value->type = CONNMAN_VALUE_BYTE;
+		break;
+	case DBUS_TYPE_UINT16:
+		dbus_message_iter_get_basic(variant, &value->data.uint16);
+		value->type = CONNMAN_VALUE_UINT16;
+		break;
+	case DBUS_TYPE_INT32:
+		dbus_message_iter_get_basic(variant, &value->data.int32);
+		value->type = CONNMAN_VALUE_INT32;
+		break;
+	case DBUS_TYPE_UINT32:
+		dbus_message_iter_get_basic(variant, &value->data.uint32);
+		value->type = CONNMAN_VALUE_UINT32;
+		break;
+	case DBUS_TYPE_STRING:
+	case DBUS_TYPE_OBJECT_PATH:
+		dbus_message_iter_get_basic(variant, &value->data.string);
+		value->type = CONNMAN_VALUE_STRING;
+		break;
+	case DBUS_TYPE_ARRAY:
+		if (dbus_message_iter_get_element_type(variant) !=
+							DBUS_TYPE_STRING)
+			return FALSE;
+
+		value->type = CONNMAN_VALUE_STRING_ARRAY;
+		value->array = variant;
+		break;
+	default:
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+int __connman_error2errno(const char *name)
+{
+	if (g_strcmp0(name, DBUS_ERROR_NO_REPLY) == 0 ||
+				g_strcmp0(name, DBUS_ERROR_TIMEOUT) == 0)
+		return -ETIMEDOUT;
+
+	if (g_strcmp0(name, CONNMAN_ERROR ".AlreadyConnected") == 0)
+		return -EISCONN;
+
+	if (g_strcmp0(name, CONNMAN_ERROR ".NotConnected") == 0)
+		return -ENOTCONN;
+
+	if (g_strcmp0(name, CONNMAN_ERROR ".InProgress") == 0)
+		return -EINPROGRESS;
+
+	if (g_strcmp0(name, CONNMAN_ERROR ".OperationAborted") == 0)
+		return -ECANCELED;
+
+	return -EIO;
+}
+
+static uint32_t generation = 0;
+
+uint32_t connman_get_generation(void)
+{
+	return generation;
+}
+
+uint32_t __connman_generation_next(void)
+{
+	return ++generation;
+}
+
+/* Method call template, for one object, method and body signature */
+struct message_template {
+	char *path;
+	const char *interface;	/* interned, as the two below */
+	const char *method;
+	const char *signature;
+	DBusMessage *message;
+};
+
+static GHashTable *templates = NULL;
+
+static guint template_hash(gconstpointer key)
+{
+	const struct message_template *template = key;
+
+	return g_str_hash(template->path) ^
+				g_str_hash(template->method) * 31 ^
+				g_str_hash(template->signature) * 961;
+}
+
+static gboolean template_equal(gconstpointer a, gconstpointer b)
+{
+	const struct message_template *template_a = a;
+	const struct message_template *template_b = b;
+
+	return g_strcmp0(template_a->path, template_b->path) == 0 &&
+		g_strcmp0(template_a->method, template_b->method) == 0 &&
+		g_strcmp0(template_a->interface, template_b->interface) == 0 &&
+		g_strcmp0(template_a->signature, template_b->signature) == 0;
+}
+
+static void template_free(gpointer data)
+{
+	struct message_template *template = data;
+
+	dbus_message_unref(template->message);
+	g_free(template->path);
+	g_free(template);
+}
+
+DBusMessage *__connman_message_new_method_call(const char *path,
+					const char *interface,
+					const char *method,
+					const char *signature)
+{
+	struct message_template key, *template;
+
+	if (templates == NULL) {
+		templates = g_hash_table_new_full(template_hash,
+					template_equal, template_free, NULL);
+		if (templates == NULL)
+			return NULL;
+	}
+
+	key.path = (char *) path;
+	key.interface = interface;
+	key.method = method;
+	key.signature = signature != NULL ? signature : "";
+
+	template = g_hash_table_lookup(templates, &key);
+	if (template != NULL)
+		return dbus_message_copy(template->message);
+
+	template = g_try_malloc0(sizeof(struct message_template));
+	if (template == NULL)
+		return NULL;
+
+	template->message = dbus_message_new_method_call(CONNMAN_DBUS_NAME,
+						path, interface, method);
+	if (template->message == NULL) {
+		g_free(template);
+		return NULL;
+	}
+
+	template->path = g_strdup(path);
+	template->interface = connman_intern(interface);
+	template->method = connman_intern(method);
+	template->signature = connman_intern(key.signature);
+
+	g_hash_table_replace(templates, template, template);
+
+	return dbus_message_copy(template->message);
+}
+
+static gboolean template_has_path(gpointer key, gpointer value,
+							gpointer user_data)
+{
+	struct message_template *template = key;
+
+	return g_strcmp0(template->path, user_data) == 0;
+}
+
+void __connman_message_drop_templates(const char *path)
+{
+	if (templates == NULL)
+		return;
+
+	g_hash_table_foreach_remove(templates, template_has_path,
+							(gpointer) path);
+}
+
+static void request_free(gpointer data)
+{
+	struct connman_request *request = data;
+
+	if (request->call != NULL) {
+		dbus_pending_call_cancel(request->call);
+		dbus_pending_call_unref(request->call);
+	}
+
+	g_free(request->path);
+	g_free(request);
+}
+
+static void request_reply_cb(DBusPendingCall *pending, void *user_data)
+{
+	struct connman_request *request;
+	struct connman_reply result;
+	DBusMessage *reply;
+	DBusError error;
+
+	if (dbus_pending_call_get_completed(pending) == FALSE)
+		return;
+
+	/* Out of the table, so that the callback may cancel it harmlessly */
+	request = g_hash_table_lookup(requests, user_data);
+	if (request == NULL)
+		return;
+
+	g_hash_table_steal(requests, user_data);
+
+	memset(&result, 0, sizeof(struct connman_reply));
+	result.path = request->path;
+	result.method = request->method;
+	result.latency = g_get_monotonic_time() - request->sent;
+
+	dbus_error_init(&error);
+
+	reply = dbus_pending_call_steal_reply(pending);
+	if (reply == NULL)
+		result.error = -EIO;
+	else if (dbus_set_error_from_message(&error, reply) == TRUE) {
+		result.error = __connman_error2errno(error.name);
+		result.error_name = error.name;
+	}
+
+	if (request->hook != NULL)
+		request->hook(&result, NULL);
+
+	if (request->callback != NULL)
+		request->callback(&result, request->user_data);
+
+	dbus_error_free(&error);
+
+	if (reply != NULL)
+		dbus_message_unref(reply);
+
+	dbus_pending_call_unref(request->call);
+	request->call = NULL;
+
+	request_free(request);
+}
+
+guint __connman_request_send(DBusConnection *dbus_cnx, DBusMessage *message,
+				int timeout, connman_reply_cb_f callback,
+				void *user_data)
+{
+	struct connman_request *request;
+	guint id;
+
+	if (requests == NULL) {
+		requests = g_hash_table_new_full(g_direct_hash,
+					g_direct_equal, NULL, request_free);
+		if (requests == NULL)
+			return 0;
+	}
+
+	request = g_try_malloc0(sizeof(struct connman_request));
+	if (request == NULL)
+		return 0;
+
+	if (timeout < 0)
+		timeout = DBUS_TIMEOUT_USE_DEFAULT;
+
+	request->path = g_strdup(dbus_message_get_path(message));
+	request->method = connman_intern(dbus_message_get_member(message));
+	request->callback = callback;
+	request->user_data = user_data;
+	request->sent = g_get_monotonic_time();
+
+	if (dbus_connection_send_with_reply(dbus_cnx, message,
+					&request->call, timeout) == FALSE ||
+						request->call == NULL)
+		goto error;
+
+	/* 0 is never a valid id */
+	if (++last_request_id == 0)
+		last_request_id++;
+	id = last_request_id;
+
+	g_hash_table_replace(requests, GUINT_TO_POINTER(id), request);
+
+	if (dbus_pending_call_set_notify(request->call, request_reply_cb,
+					GUINT_TO_POINTER(id), NULL) == FALSE) {
+		g_hash_table_remove(requests, GUINT_TO_POINTER(id));
+		return 0;
+	}
+
+	return id;
+
+error:
+	request_free(request);
+
+	return 0;
+}
+
+void __connman_request_set_hook(guint id, connman_reply_cb_f hook)
+{
+	struct connman_request *request;
+
+	if (requests == NULL || id == 0)
+		return;
+
+	request = g_hash_table_lookup(requests, GUINT_TO_POINTER(id));
+	if (request != NULL)
+		request->hook = hook;
+}
+
+int connman_request_cancel(guint id)
+{
+	if (requests == NULL || id == 0)
+		return -EINVAL;
+
+	if (g_hash_table_remove(requests, GUINT_TO_POINTER(id)) == FALSE)
+		return -EINVAL;
+
+	return 0;
+}
+
 int connman_interface_init(connman_interface_cb_f interface_connected_cb,
 			connman_interface_cb_f interface_disconnected_cb,
 			void *user_data)
@@ -123,6 +463,16 @@ void connman_interface_finalize(void)
 
 	g_dbus_remove_all_watches(connman->dbus_cnx);
 
+	if (requests != NULL) {
+		g_hash_table_destroy(requests);
+		requests = NULL;
+	}
+
+	if (templates != NULL) {
+		g_hash_table_destroy(templates);
+		templates = NULL;
+	}
+
 	dbus_connection_unref(connman->dbus_cnx);
 
 	if (dbus_cnx_session != NULL)
@@ -40,6 +40,15 @@ static const char *Manager_updatable_properties[] = {
 	"OfflineMode",
 };
 
+/*
+ * The service list and the service visitor issue their own GetServices
+ * call, so that a visit does not cancel a refresh and vice versa.
+ */
+struct services_request {
+	DBusPendingCall *call;
+	connman_manager_get_services_cb_f cb;
+};
+
 struct connman_manager {
 	DBusConnection *dbus_cnx;
 
@@ -52,7 +61,9 @@ struct connman_manager {
 	enum connman_state state;
 	gboolean offlinemode;
 
-	guint source[MANAGER_MAX];
+	/* Changed properties, reported together from to_flush */
+	uint32_t dirty;
+	guint to_flush;
 
 	/* Technology part */
 	DBusPendingCall *get_technologies_call;
@@ -64,37 +75,36 @@ struct connman_manager {
 	connman_manager_technology_removed_cb_f technology_removed_cb;
 
 	/* Service part */
-	DBusPendingCall *get_services_call;
+	struct services_request get_services;
+	struct services_request visit_services;
 	guint services_changed_wid;
 
-	connman_manager_get_services_cb_f get_services_cb;
 	connman_manager_service_changed_cb services_changed_cb;
 };
 
 static struct connman_manager *manager = NULL;
 
-static void destroy_property(gpointer user_data)
+static gboolean flush_properties(gpointer user_data)
 {
-	struct property_change *property = user_data;
-
-	if (property == NULL)
-		return;
+	uint32_t dirty;
+	int i;
 
-	if (manager != NULL)
-		manager->source[property->index] = 0;
+	if (manager == NULL)
+		return FALSE;
 
-	g_free(property);
-}
+	dirty = manager->dirty;
 
-static gboolean property_changed(gpointer user_data)
-{
-	struct property_change *property = user_data;
+	manager->dirty = 0;
+	manager->to_flush = 0;
 
-	if (manager == NULL || manager->property_changed_cb == NULL)
-		return FALSE;
+	for (i = 0; i < MANAGER_MAX && manager != NULL; i++) {
+		if ((dirty & (1 << i)) == 0)
+			continue;
 
-	manager->property_changed_cb(property->path, property->name,
+		if (manager->property_changed_cb != NULL)
+			manager->property_changed_cb(NULL, PROPERTY(i),
 						manager->property_user_data);
+	}
 
 	return FALSE;
 }
@@ -115,30 +125,58 @@ enum connman_state string2enum_state(const char *state)
 	return CONNMAN_STATE_OFFLINE;
 }
 
-static void update_manager_property(int index)
+enum connman_tech_type string2enum_tech_type(const char *type)
 {
-	struct property_change *property;
+	if (g_strcmp0(type, "ethernet") == 0)
+		return CONNMAN_TECH_TYPE_ETHERNET;
+	else if (g_strcmp0(type, "wifi") == 0)
+		return CONNMAN_TECH_TYPE_WIFI;
+	else if (g_strcmp0(type, "wimax") == 0)
+		return CONNMAN_TECH_TYPE_WIMAX;
+	else if (g_strcmp0(type, "bluetooth") == 0)
+		return CONNMAN_TECH_TYPE_BLUETOOTH;
+	else if (g_strcmp0(type, "cellular") == 0)
+		return CONNMAN_TECH_TYPE_CELLULAR;
+	else if (g_strcmp0(type, "gps") == 0)
+		return CONNMAN_TECH_TYPE_GPS;
+	else if (g_strcmp0(type, "vpn") == 0)
+		return CONNMAN_TECH_TYPE_VPN;
+	else if (g_strcmp0(type, "gadget") == 0)
+		return CONNMAN_TECH_TYPE_GADGET;
+	else if (g_strcmp0(type, "p2p") == 0)
+		return CONNMAN_TECH_TYPE_P2P;
+
+	return CONNMAN_TECH_TYPE_UNKNOWN;
+}
 
-	property = g_try_malloc0(sizeof(struct property_change));
-	if (property == NULL)
-		return;
+static void update_manager_property(int index)
+{
+	manager->dirty |= 1 << index;
 
-	if (manager->source[index] != 0)
-		g_source_remove(manager->source[index]);
+	if (manager->to_flush == 0)
+		manager->to_flush = g_timeout_add_full(G_PRIORITY_DEFAULT, 0,
+						flush_properties, NULL, NULL);
+}
 
-	property->index = index;
-	property->name = PROPERTY(index);
+struct manager_properties {
+	const char *state;
+	dbus_bool_t offlinemode;
+};
 
-	manager->source[index] = g_timeout_add_full(G_PRIORITY_DEFAULT, 0,
-				property_changed, property, destroy_property);
-}
+static const struct cui_dbus_dict_spec manager_spec[] = {
+	CUI_DBUS_DICT_BASIC("State", DBUS_TYPE_STRING,
+				struct manager_properties, state),
+	CUI_DBUS_DICT_BASIC("OfflineMode", DBUS_TYPE_BOOLEAN,
+				struct manager_properties, offlinemode),
+	CUI_DBUS_DICT_SPEC_END,
+};
 
 static void get_properties_callback(DBusPendingCall *pending, void *user_data)
 {
-	dbus_bool_t offlinemode;
+	struct manager_properties properties;
 	DBusMessageIter arg;
 	DBusMessage *reply;
-	const char *state;
+	uint32_t found;
 
 	if (dbus_pending_call_get_completed(pending) == FALSE)
 		return;
@@ -152,17 +190,16 @@ static void get_properties_callback(DBusPendingCall *pending, void *user_data)
 	if (dbus_message_iter_init(reply, &arg) == FALSE)
 		goto error;
 
-	if (cui_dbus_get_dict_entry_basic(&arg,
-				PROPERTY(MANAGER_STATE),
-				DBUS_TYPE_STRING, &state) == 0) {
-		manager->state = string2enum_state(state);
+	if (cui_dbus_get_dict(&arg, manager_spec, &properties, &found) < 0)
+		goto error;
+
+	if (found & (1 << MANAGER_STATE)) {
+		manager->state = string2enum_state(properties.state);
 		update_manager_property(MANAGER_STATE);
 	}
 
-	if (cui_dbus_get_dict_entry_basic(&arg,
-				PROPERTY(MANAGER_OFFLINEMODE),
-				DBUS_TYPE_BOOLEAN, &offlinemode) == 0) {
-		manager->offlinemode = offlinemode;
+	if (found & (1 << MANAGER_OFFLINEMODE)) {
+		manager->offlinemode = properties.offlinemode;
 		update_manager_property(MANAGER_OFFLINEMODE);
 	}
 
@@ -190,22 +227,35 @@ static gboolean property_changed_signal_cb(DBusConnection *dbus_cnx,
 
 	dbus_message_iter_next(&arg);
 
-	if (g_strcmp0(name, PROPERTY(MANAGER_STATE)) == 0) {
+	switch (property_key(name)) {
+	case PROPERTY_KEY(5, 'S', 't', 'e'): {
 		const char *state;
 
+		if (strcmp(name, PROPERTY(MANAGER_STATE)) != 0)
+			break;
+
 		if (cui_dbus_get_basic_variant(&arg,
 					DBUS_TYPE_STRING, &state) == 0) {
 			manager->state = string2enum_state(state);
 			update_manager_property(MANAGER_STATE);
 		}
-	} else if (g_strcmp0(name, PROPERTY(MANAGER_OFFLINEMODE)) == 0) {
+		break;
+	}
+	case PROPERTY_KEY(11, 'O', 'l', 'e'): {
 		dbus_bool_t offlinemode;
 
+		if (strcmp(name, PROPERTY(MANAGER_OFFLINEMODE)) != 0)
+			break;
+
 		if (cui_dbus_get_basic_variant(&arg,
 				DBUS_TYPE_BOOLEAN, &offlinemode) == 0) {
 			manager->offlinemode = offlinemode;
 			update_manager_property(MANAGER_OFFLINEMODE);
 		}
+		break;
+	}
+	default:
+		break;
 	}
 
 	return TRUE;
@@ -232,7 +282,7 @@ static void get_technologies_callback(DBusPendingCall *pending, void *user_data)
 		goto error;
 
 	if (callback != NULL)
-		callback(&arg);
+		callback(reply, &arg);
 error:
 	if (reply != NULL)
 		dbus_message_unref(reply);
@@ -252,7 +302,7 @@ static gboolean technology_added_signal_cb(DBusConnection *dbus_cnx,
 		return TRUE;
 
 	if (manager->technology_added_cb != NULL)
-		manager->technology_added_cb(&arg);
+		manager->technology_added_cb(message, &arg);
 
 	return TRUE;
 }
@@ -276,6 +326,7 @@ static gboolean technology_removed_signal_cb(DBusConnection *dbus_cnx,
 
 static void get_services_callback(DBusPendingCall *pending, void *user_data)
 {
+	struct services_request *request = user_data;
 	connman_manager_get_services_cb_f callback;
 	DBusMessageIter arg;
 	DBusMessage *reply;
@@ -283,9 +334,9 @@ static void get_services_callback(DBusPendingCall *pending, void *user_data)
 	if (dbus_pending_call_get_completed(pending) == FALSE)
 		return;
 
-	manager->get_services_call = NULL;
-	callback = manager->get_services_cb;
-	manager->get_services_cb = NULL;
+	request->call = NULL;
+	callback = request->cb;
+	request->cb = NULL;
 
 	reply = dbus_pending_call_steal_reply(pending);
 	if (reply == NULL)
@@ -295,7 +346,7 @@ static void get_services_callback(DBusPendingCall *pending, void *user_data)
 		goto error;
 
 	if (callback != NULL)
-		callback(&arg);
+		callback(reply, &arg);
 error:
 	if (reply != NULL)
 		dbus_message_unref(reply);
@@ -315,7 +366,7 @@ static gboolean services_changed_signal_cb(DBusConnection *dbus_cnx,
 		return TRUE;
 
 	if (manager->services_changed_cb != NULL)
-		manager->services_changed_cb(&arg);
+		manager->services_changed_cb(message, &arg);
 
 	return TRUE;
 }
@@ -339,10 +390,9 @@ int __connman_manager_get_technologies(connman_manager_get_technologies_cb_f cb)
 	if (cb == NULL)
 		return 0;
 
-	message = dbus_message_new_method_call(CONNMAN_DBUS_NAME,
-						CONNMAN_MANAGER_PATH,
-						CONNMAN_MANAGER_INTERFACE,
-						"GetTechnologies");
+	message = __connman_message_new_method_call(CONNMAN_MANAGER_PATH,
+					CONNMAN_MANAGER_INTERFACE,
+					"GetTechnologies", NULL);
 	if (message == NULL)
 		return -ENOMEM;
 
@@ -426,41 +476,44 @@ error:
 	return -EINVAL;
 }
 
-int __connman_manager_get_services(connman_manager_get_services_cb_f cb)
+static void cancel_services_request(struct services_request *request)
 {
-	DBusMessage *message;
+	request->cb = NULL;
 
-	if (manager == NULL)
-		return -EINVAL;
+	if (request->call == NULL)
+		return;
 
-	manager->get_services_cb = NULL;
+	dbus_pending_call_cancel(request->call);
+	dbus_pending_call_unref(request->call);
 
-	if (manager->get_services_call != NULL) {
-		dbus_pending_call_cancel(manager->get_services_call);
-		dbus_pending_call_unref(manager->get_services_call);
+	request->call = NULL;
+}
 
-		manager->get_services_call = NULL;
-	}
+static int request_services(struct services_request *request,
+					connman_manager_get_services_cb_f cb)
+{
+	DBusMessage *message;
+
+	cancel_services_request(request);
 
 	if (cb == NULL)
 		return 0;
 
-	message = dbus_message_new_method_call(CONNMAN_DBUS_NAME,
-						CONNMAN_MANAGER_PATH,
-						CONNMAN_MANAGER_INTERFACE,
-						"GetServices");
+	message = __connman_message_new_method_call(CONNMAN_MANAGER_PATH,
+					CONNMAN_MANAGER_INTERFACE,
+					"GetServices", NULL);
 	if (message == NULL)
 		return -ENOMEM;
 
-	manager->get_services_cb = cb;
+	request->cb = cb;
 
 	if (dbus_connection_send_with_reply(manager->dbus_cnx, message,
-					&manager->get_services_call,
+					&request->call,
 					DBUS_TIMEOUT_USE_DEFAULT) == FALSE)
 		goto error;
 
-	if (dbus_pending_call_set_notify(manager->get_services_call,
-				get_services_callback, NULL, NULL) == FALSE)
+	if (dbus_pending_call_set_notify(request->call,
+				get_services_callback, request, NULL) == FALSE)
 		goto error;
 
 	dbus_message_unref(message);
@@ -468,11 +521,28 @@ int __connman_manager_get_services(connman_manager_get_services_cb_f cb)
 	return 0;
 
 error:
+	request->cb = NULL;
 	dbus_message_unref(message);
 
 	return -EINVAL;
 }
 
+int __connman_manager_get_services(connman_manager_get_services_cb_f cb)
+{
+	if (manager == NULL)
+		return -EINVAL;
+
+	return request_services(&manager->get_services, cb);
+}
+
+int __connman_manager_visit_services(connman_manager_get_services_cb_f cb)
+{
+	if (manager == NULL)
+		return -EINVAL;
+
+	return request_services(&manager->visit_services, cb);
+}
+
 int __connman_manager_register_service_signal(connman_manager_service_changed_cb cb)
 {
 	if (manager == NULL)
@@ -571,17 +641,13 @@ error:
 
 void connman_manager_finalize(void)
 {
-	int i;
-
 	if (manager == NULL)
 		return;
 
 	manager->property_changed_cb = NULL;
 
-	for (i = 0; i < MANAGER_MAX; i++) {
-		if (manager->source[i] != 0)
-			g_source_remove(manager->source[i]);
-	}
+	if (manager->to_flush != 0)
+		g_source_remove(manager->to_flush);
 
 	if (manager->get_properties_call != NULL) {
 		dbus_pending_call_cancel(manager->get_properties_call);
@@ -604,10 +670,10 @@ void connman_manager_finalize(void)
 		g_dbus_remove_watch(manager->dbus_cnx,
 					manager->technology_removed_wid);
 
-	if (manager->get_services_call != NULL) {
-		dbus_pending_call_cancel(manager->get_services_call);
-		dbus_pending_call_unref(manager->get_services_call);
-	}
+	cancel_services_request(&manager->get_services);
+	cancel_services_request(&manager->visit_services);
+
+	__connman_message_drop_templates(CONNMAN_MANAGER_PATH);
 
 	dbus_connection_unref(manager->dbus_cnx);
 
@@ -615,32 +681,64 @@ void connman_manager_finalize(void)
 	manager = NULL;
 }
 
+static DBusMessage *new_offlinemode_message(gboolean offlinemode)
+{
+	DBusMessage *message;
+
+	message = __connman_message_new_method_call(CONNMAN_MANAGER_PATH,
+					CONNMAN_MANAGER_INTERFACE,
+					"SetProperty", "sv");
+	if (message == NULL)
+		return NULL;
+
+	if (cui_dbus_append_set_property(message,
+				PROPERTY(MANAGER_OFFLINEMODE),
+				DBUS_TYPE_BOOLEAN, &offlinemode) < 0) {
+		dbus_message_unref(message);
+		return NULL;
+	}
+
+	return message;
+}
+
 int connman_manager_set_offlinemode(gboolean offlinemode)
 {
 	DBusMessage *message;
-	DBusMessageIter arg;
 
 	if (manager == NULL)
 		return -EINVAL;
 
-	message = dbus_message_new_method_call(CONNMAN_DBUS_NAME,
-						CONNMAN_MANAGER_PATH,
-						CONNMAN_MANAGER_INTERFACE,
-						"SetProperty");
+	message = new_offlinemode_message(offlinemode);
 	if (message == NULL)
 		return -ENOMEM;
 
-	dbus_message_iter_init_append(message, &arg);
-
-	cui_dbus_append_basic(&arg, PROPERTY(MANAGER_OFFLINEMODE),
-					DBUS_TYPE_BOOLEAN, &offlinemode);
-
 	if (g_dbus_send_message(manager->dbus_cnx, message) == FALSE)
 		return -EINVAL;
 
 	return 0;
 }
 
+guint connman_manager_set_offlinemode_async(gboolean offlinemode,
+				int timeout, connman_reply_cb_f callback,
+				void *user_data)
+{
+	DBusMessage *message;
+	guint id;
+
+	if (manager == NULL)
+		return 0;
+
+	message = new_offlinemode_message(offlinemode);
+	if (message == NULL)
+		return 0;
+
+	id = __connman_request_send(manager->dbus_cnx, message,
+					timeout, callback, user_data);
+	dbus_message_unref(message);
+
+	return id;
+}
+
 enum connman_state connman_manager_get_state(void)
 {
 	if (manager == NULL)
@@ -657,28 +755,60 @@ gboolean connman_manager_get_offlinemode(void)
 	return manager->offlinemode;
 }
 
-void connman_manager_register_agent(const char *path)
+static DBusMessage *new_register_agent_message(const char *path)
 {
 	DBusMessage *message;
 	DBusMessageIter arg;
 
-	if (manager == NULL)
-		return;
-
 	message = dbus_message_new_method_call(CONNMAN_DBUS_NAME,
 						CONNMAN_MANAGER_PATH,
 						CONNMAN_MANAGER_INTERFACE,
 						"RegisterAgent");
 	if (message == NULL)
-		return;
+		return NULL;
 
 	dbus_message_iter_init_append(message, &arg);
 
 	cui_dbus_append_basic(&arg, NULL, DBUS_TYPE_OBJECT_PATH, &path);
 
+	return message;
+}
+
+void connman_manager_register_agent(const char *path)
+{
+	DBusMessage *message;
+
+	if (manager == NULL)
+		return;
+
+	message = new_register_agent_message(path);
+	if (message == NULL)
+		return;
+
 	g_dbus_send_message(manager->dbus_cnx, message);
 }
 
+guint connman_manager_register_agent_async(const char *path,
+				int timeout, connman_reply_cb_f callback,
+				void *user_data)
+{
+	DBusMessage *message;
+	guint id;
+
+	if (manager == NULL)
+		return 0;
+
+	message = new_register_agent_message(path);
+	if (message == NULL)
+		return 0;
+
+	id = __connman_request_send(manager->dbus_cnx, message,
+					timeout, callback, user_data);
+	dbus_message_unref(message);
+
+	return id;
+}
+
 void connman_manager_unregister_agent(const char *path)
 {
 	DBusMessage *message;
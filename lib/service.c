@@ -29,27 +29,32 @@
 #define PROPERTY(n) Service_updatable_properties[n]
 
 enum connman_service_property {
-	SERVICE_STATE                     = 0,
-	SERVICE_ERROR                     = 1,
-	SERVICE_STRENGTH                  = 2,
-	SERVICE_FAVORITE                  = 3,
-	SERVICE_AUTOCONNECT               = 4,
-	SERVICE_ROAMING                   = 5,
-	SERVICE_NAMESERVERS               = 6,
-	SERVICE_NAMESERVERS_CONFIGURATION = 7,
-	SERVICE_TIMESERVERS               = 8,
-	SERVICE_TIMESERVERS_CONFIGURATION = 9,
-	SERVICE_DOMAINS                   = 10,
-	SERVICE_DOMAINS_CONFIGURATION     = 11,
-	SERVICE_IPv4                      = 12,
-	SERVICE_IPv4_CONFIGURATION        = 13,
-	SERVICE_IPv6                      = 14,
-	SERVICE_IPv6_CONFIGURATION        = 15,
-	SERVICE_PROXY                     = 16,
-	SERVICE_PROXY_CONFIGURATION       = 17,
-	SERVICE_PROVIDER                  = 18,
-	SERVICE_ETHERNET                  = 19,
-	SERVICE_MAX                       = 20,
+	SERVICE_STATE                     = CONNMAN_SERVICE_STATE,
+	SERVICE_ERROR                     = CONNMAN_SERVICE_ERROR,
+	SERVICE_STRENGTH                  = CONNMAN_SERVICE_STRENGTH,
+	SERVICE_FAVORITE                  = CONNMAN_SERVICE_FAVORITE,
+	SERVICE_AUTOCONNECT               = CONNMAN_SERVICE_AUTOCONNECT,
+	SERVICE_ROAMING                   = CONNMAN_SERVICE_ROAMING,
+	SERVICE_NAMESERVERS               = CONNMAN_SERVICE_NAMESERVERS,
+	SERVICE_NAMESERVERS_CONFIGURATION = CONNMAN_SERVICE_NAMESERVERS_CONFIGURATION,
+	SERVICE_TIMESERVERS               = CONNMAN_SERVICE_TIMESERVERS,
+	SERVICE_TIMESERVERS_CONFIGURATION = CONNMAN_SERVICE_TIMESERVERS_CONFIGURATION,
+	SERVICE_DOMAINS                   = CONNMAN_SERVICE_DOMAINS,
+	SERVICE_DOMAINS_CONFIGURATION     = CONNMAN_SERVICE_DOMAINS_CONFIGURATION,
+	SERVICE_IPv4                      = CONNMAN_SERVICE_IPv4,
+	SERVICE_IPv4_CONFIGURATION        = CONNMAN_SERVICE_IPv4_CONFIGURATION,
+	SERVICE_IPv6                      = CONNMAN_SERVICE_IPv6,
+	SERVICE_IPv6_CONFIGURATION        = CONNMAN_SERVICE_IPv6_CONFIGURATION,
+	SERVICE_PROXY                     = CONNMAN_SERVICE_PROXY,
+	SERVICE_PROXY_CONFIGURATION       = CONNMAN_SERVICE_PROXY_CONFIGURATION,
+	SERVICE_PROVIDER                  = CONNMAN_SERVICE_PROVIDER,
+	SERVICE_ETHERNET                  = CONNMAN_SERVICE_ETHERNET,
+	SERVICE_MAX                       = CONNMAN_SERVICE_MAX,
+	SERVICE_NAME                      = CONNMAN_SERVICE_NAME,
+	SERVICE_TYPE                      = CONNMAN_SERVICE_TYPE,
+	SERVICE_SECURITY                  = CONNMAN_SERVICE_SECURITY,
+	SERVICE_IMMUTABLE                 = CONNMAN_SERVICE_IMMUTABLE,
+	SERVICE_FIELD_MAX                 = 25,
 };
 
 static const char *Service_updatable_properties[] = {
@@ -75,21 +80,173 @@ static const char *Service_updatable_properties[] = {
 	"Ethernet",
 };
 
-struct connman_service {
-	char *path;
+static const char *Service_static_properties[] = {
+	"Name",
+	"Type",
+	"Security",
+	"Immutable",
+};
 
-	enum connman_state state;
-	char *error;
-	char *name;
-	char *type;
-	char *security;
+static int service_property_index(const char *name)
+{
+	const char *property_name;
+	int index;
 
-	uint8_t strength;
+	switch (property_key(name)) {
+	case PROPERTY_KEY(5, 'S', 't', 'e'):
+		index = SERVICE_STATE;
+		break;
+	case PROPERTY_KEY(5, 'E', 'o', 'r'):
+		index = SERVICE_ERROR;
+		break;
+	case PROPERTY_KEY(8, 'S', 'e', 'h'):
+		index = SERVICE_STRENGTH;
+		break;
+	case PROPERTY_KEY(8, 'F', 'o', 'e'):
+		index = SERVICE_FAVORITE;
+		break;
+	case PROPERTY_KEY(11, 'A', 'o', 't'):
+		index = SERVICE_AUTOCONNECT;
+		break;
+	case PROPERTY_KEY(7, 'R', 'm', 'g'):
+		index = SERVICE_ROAMING;
+		break;
+	case PROPERTY_KEY(11, 'N', 'e', 's'):
+		index = SERVICE_NAMESERVERS;
+		break;
+	case PROPERTY_KEY(25, 'N', 'e', 'n'):
+		index = SERVICE_NAMESERVERS_CONFIGURATION;
+		break;
+	case PROPERTY_KEY(11, 'T', 'e', 's'):
+		index = SERVICE_TIMESERVERS;
+		break;
+	case PROPERTY_KEY(25, 'T', 'e', 'n'):
+		index = SERVICE_TIMESERVERS_CONFIGURATION;
+		break;
+	case PROPERTY_KEY(7, 'D', 'a', 's'):
+		index = SERVICE_DOMAINS;
+		break;
+	case PROPERTY_KEY(21, 'D', 'a', 'n'):
+		index = SERVICE_DOMAINS_CONFIGURATION;
+		break;
+	case PROPERTY_KEY(4, 'I', '4', '4'):
+		index = SERVICE_IPv4;
+		break;
+	case PROPERTY_KEY(18, 'I', '4', 'n'):
+		index = SERVICE_IPv4_CONFIGURATION;
+		break;
+	case PROPERTY_KEY(4, 'I', '6', '6'):
+		index = SERVICE_IPv6;
+		break;
+	case PROPERTY_KEY(18, 'I', '6', 'n'):
+		index = SERVICE_IPv6_CONFIGURATION;
+		break;
+	case PROPERTY_KEY(5, 'P', 'x', 'y'):
+		index = SERVICE_PROXY;
+		break;
+	case PROPERTY_KEY(19, 'P', 'x', 'n'):
+		index = SERVICE_PROXY_CONFIGURATION;
+		break;
+	case PROPERTY_KEY(8, 'P', 'v', 'r'):
+		index = SERVICE_PROVIDER;
+		break;
+	case PROPERTY_KEY(8, 'E', 'e', 't'):
+		index = SERVICE_ETHERNET;
+		break;
+	case PROPERTY_KEY(4, 'N', 'e', 'e'):
+		index = SERVICE_NAME;
+		break;
+	case PROPERTY_KEY(4, 'T', 'e', 'e'):
+		index = SERVICE_TYPE;
+		break;
+	case PROPERTY_KEY(8, 'S', 'u', 'y'):
+		index = SERVICE_SECURITY;
+		break;
+	case PROPERTY_KEY(9, 'I', 'u', 'e'):
+		index = SERVICE_IMMUTABLE;
+		break;
+	default:
+		return -1;
+	}
+
+	if (index < SERVICE_MAX)
+		property_name = PROPERTY(index);
+	else
+		property_name = Service_static_properties[index - SERVICE_NAME];
+
+	if (strcmp(name, property_name) != 0)
+		return -1;
+
+	return index;
+}
+
+enum service_method {
+	SERVICE_METHOD_SET_PROPERTY = 0,
+	SERVICE_METHOD_CONNECT      = 1,
+	SERVICE_METHOD_DISCONNECT   = 2,
+	SERVICE_METHOD_REMOVE       = 3,
+	SERVICE_METHOD_MAX          = 4,
+};
+
+static const char *Service_methods[] = {
+	"SetProperty",
+	"Connect",
+	"Disconnect",
+	"Remove",
+};
+
+/*
+ * Values that can be borrowed from the message which carried them,
+ * each of them holding a reference on that message.
+ */
+enum service_backing {
+	BACKING_ERROR      = 0,
+	BACKING_IPv4       = 1,
+	BACKING_IPv4_CONF  = 2,
+	BACKING_IPv6       = 3,
+	BACKING_IPv6_CONF  = 4,
+	BACKING_PROXY      = 5,
+	BACKING_PROXY_CONF = 6,
+	BACKING_PROVIDER   = 7,
+	BACKING_ETHERNET   = 8,
+	BACKING_MAX        = 9,
+};
 
-	gboolean favorite;
-	gboolean immutable;
-	gboolean autoconnect;
-	gboolean roaming;
+/* Dictionary fields, compared once decoded rather than hashed */
+#define SERVICE_DICT_FIELDS						\
+	((1U << SERVICE_IPv4) |						\
+	(1U << SERVICE_IPv4_CONFIGURATION) |				\
+	(1U << SERVICE_IPv6) |						\
+	(1U << SERVICE_IPv6_CONFIGURATION) |				\
+	(1U << SERVICE_PROXY) |						\
+	(1U << SERVICE_PROXY_CONFIGURATION) |				\
+	(1U << SERVICE_PROVIDER) |					\
+	(1U << SERVICE_ETHERNET))
+
+/* Fields stored in struct service_details */
+#define SERVICE_DETAILS_FIELDS						\
+	((1U << SERVICE_ERROR) |					\
+	(1U << SERVICE_NAMESERVERS) |					\
+	(1U << SERVICE_NAMESERVERS_CONFIGURATION) |			\
+	(1U << SERVICE_TIMESERVERS) |					\
+	(1U << SERVICE_TIMESERVERS_CONFIGURATION) |			\
+	(1U << SERVICE_DOMAINS) |					\
+	(1U << SERVICE_DOMAINS_CONFIGURATION) |				\
+	(1U << SERVICE_IPv4) |						\
+	(1U << SERVICE_IPv4_CONFIGURATION) |				\
+	(1U << SERVICE_IPv6) |						\
+	(1U << SERVICE_IPv6_CONFIGURATION) |				\
+	(1U << SERVICE_PROXY) |						\
+	(1U << SERVICE_PROXY_CONFIGURATION) |				\
+	(1U << SERVICE_PROVIDER) |					\
+	(1U << SERVICE_ETHERNET))
+
+/*
+ * Most services are never connected nor configured: what only those
+ * have is allocated once a non empty value shows up.
+ */
+struct service_details {
+	char *error;
 
 	char *nameservers;
 	char *nameservers_conf;
@@ -112,29 +269,136 @@ struct connman_service {
 	struct connman_provider *provider;
 	struct connman_ethernet *ethernet;
 
+	DBusMessage *backing[BACKING_MAX];
+
+	/* Fields still to be decoded from the properties of that message */
+	uint32_t deferred;
+	DBusMessage *deferred_message;
+	DBusMessageIter deferred_dict;
+};
+
+static const struct service_details no_details;
+
+/* Only allocated while a SetProperty call or its error is pending */
+struct service_activity {
+	DBusPendingCall *call_modify[SERVICE_MAX];
+	/* Message of the pending call, for the value it applied */
+	DBusMessage *sent_modify[SERVICE_MAX];
+	/* Last value set while the call was pending, sent on its reply */
+	DBusMessage *queued_modify[SERVICE_MAX];
+	guint to_error[SERVICE_MAX];
+};
+
+/* SetProperty calls sent by connman_service_apply(), completed together */
+struct service_apply {
+	struct connman_service *service;
+	DBusPendingCall *calls[SERVICE_MAX];
+	uint32_t applied;
+	uint32_t pending;
+	uint32_t failed;
+	int errors[SERVICE_MAX];
+	connman_service_apply_cb_f done_cb;
+	void *user_data;
+};
+
+#define CONNECT_TIMELINE_MAX 8
+
+/* Last connection attempts, allocated on the first one */
+struct service_timeline {
+	struct connman_connect_timeline attempts[CONNECT_TIMELINE_MAX];
+	unsigned int last;
+	unsigned int count;
+};
+
+/* Milliseconds, in 8 buckets per power of 2 up to 2^32 */
+#define LATENCY_BUCKETS 240
+
+struct latency_histogram {
+	unsigned int count;
+	uint32_t buckets[LATENCY_BUCKETS];
+};
+
+struct connect_stats {
+	unsigned int attempts;
+	unsigned int failures;
+	struct latency_histogram ready;
+	struct latency_histogram online;
+};
+
+struct connman_service {
+	/* What sorting, filtering and drawing a list read comes first */
+	char *path;
+	char *name;
+	const char *type;
+	const char *security;
+	enum connman_state state;
+	enum connman_tech_type type_id;
+
+	/* Only valid if ordered_services holds path at that position */
+	unsigned int position;
+
+	uint8_t strength;
+
+	unsigned int favorite:1;
+	unsigned int immutable:1;
+	unsigned int autoconnect:1;
+	unsigned int roaming:1;
+
+	/* Queued in dirty_services until flushed */
+	unsigned int queued:1;
+	uint32_t dirty;
+
+	/* Set while a services list is applied in lazy mode */
+	unsigned int defer_details:1;
+
+	/* One reference is held by the services table */
+	int refcount;
+
+	/* Generation of the last field change, and of each field's */
+	uint32_t generation;
+	uint32_t field_generation[SERVICE_FIELD_MAX];
+	/* Hash of the last value received for each field */
+	uint32_t field_hash[SERVICE_FIELD_MAX];
+
+	struct service_details *details;
+	struct service_activity *activity;
+	struct service_timeline *timeline;
+
 	int update_index;
+	DBusMessage *update_message;
+	DBusMessage *name_backing;
 
-	guint property_changed_wid;
-	guint to_update[SERVICE_MAX];
 	connman_property_changed_cb_f property_changed_cb;
 	void *property_changed_user_data;
 
-	DBusPendingCall *call_modify[SERVICE_MAX];
-	guint to_error[SERVICE_MAX];
 	connman_property_set_cb_f property_set_error_cb;
 	void *property_set_error_user_data;
+
+	connman_property_applied_cb_f property_applied_cb;
+	void *property_applied_user_data;
 };
 
 struct connman_service_interface {
 	DBusConnection *dbus_cnx;
 
+	/* Watches PropertyChanged for all the services at once */
+	guint property_changed_wid;
+
 	gboolean refreshed;
 
 	GHashTable *services;
-	GSList *ordered_services;
+	GPtrArray *ordered_services;
 
 	connman_path_changed_cb_f removed_cb;
 
+	GPtrArray *dirty_services;
+	guint to_flush;
+	connman_service_changed_cb_f changed_cb;
+	void *changed_user_data;
+
+	/* Transactions of connman_service_apply() waiting for replies */
+	GSList *applies;
+
 	connman_refresh_cb_f refresh_services_cb;
 	connman_scan_cb_f scan_services_cb;
 	guint to_refresh;
@@ -145,132 +409,515 @@ struct connman_service_interface {
 
 static struct connman_service_interface *service_if = NULL;
 
-static void ipv4_free(gpointer data)
+/* Strings are borrowed from the D-Bus messages when set */
+static gboolean borrow_strings = FALSE;
+
+/* Services are kept up to date for the life of the connection when set */
+static gboolean keep_cache = FALSE;
+
+/* Details from services lists are only decoded when read when set */
+static gboolean lazy_details = FALSE;
+
+/* By service type, allocated on first use and kept across ConnMan restarts */
+static struct connect_stats *connect_stats[CONNMAN_TECH_TYPE_MAX];
+
+static const struct cui_dbus_dict_spec ipv4_spec[] = {
+	CUI_DBUS_DICT_BASIC("Method", DBUS_TYPE_STRING,
+					struct connman_ipv4, method),
+	CUI_DBUS_DICT_BASIC("Address", DBUS_TYPE_STRING,
+					struct connman_ipv4, address),
+	CUI_DBUS_DICT_BASIC("Netmask", DBUS_TYPE_STRING,
+					struct connman_ipv4, netmask),
+	CUI_DBUS_DICT_BASIC("Gateway", DBUS_TYPE_STRING,
+					struct connman_ipv4, gateway),
+	CUI_DBUS_DICT_SPEC_END,
+};
+
+static const struct cui_dbus_dict_spec ipv6_spec[] = {
+	CUI_DBUS_DICT_BASIC("Method", DBUS_TYPE_STRING,
+					struct connman_ipv6, method),
+	CUI_DBUS_DICT_BASIC("Address", DBUS_TYPE_STRING,
+					struct connman_ipv6, address),
+	CUI_DBUS_DICT_BASIC("PrefixLength", DBUS_TYPE_BYTE,
+					struct connman_ipv6, prefix),
+	CUI_DBUS_DICT_BASIC("Gateway", DBUS_TYPE_STRING,
+					struct connman_ipv6, gateway),
+	CUI_DBUS_DICT_BASIC("Privacy", DBUS_TYPE_STRING,
+					struct connman_ipv6, privacy),
+	CUI_DBUS_DICT_SPEC_END,
+};
+
+static const struct cui_dbus_dict_spec proxy_spec[] = {
+	CUI_DBUS_DICT_BASIC("Method", DBUS_TYPE_STRING,
+					struct connman_proxy, method),
+	CUI_DBUS_DICT_BASIC("URL", DBUS_TYPE_STRING,
+					struct connman_proxy, url),
+	CUI_DBUS_DICT_JOINED("Servers", struct connman_proxy, servers),
+	CUI_DBUS_DICT_JOINED("Excludes", struct connman_proxy, excludes),
+	CUI_DBUS_DICT_SPEC_END,
+};
+
+static const struct cui_dbus_dict_spec provider_spec[] = {
+	CUI_DBUS_DICT_BASIC("Host", DBUS_TYPE_STRING,
+					struct connman_provider, host),
+	CUI_DBUS_DICT_BASIC("Domain", DBUS_TYPE_STRING,
+					struct connman_provider, domain),
+	CUI_DBUS_DICT_BASIC("Name", DBUS_TYPE_STRING,
+					struct connman_provider, name),
+	CUI_DBUS_DICT_BASIC("Type", DBUS_TYPE_STRING,
+					struct connman_provider, type),
+	CUI_DBUS_DICT_SPEC_END,
+};
+
+static const struct cui_dbus_dict_spec ethernet_spec[] = {
+	CUI_DBUS_DICT_BASIC("Method", DBUS_TYPE_STRING,
+					struct connman_ethernet, method),
+	CUI_DBUS_DICT_BASIC("Interface", DBUS_TYPE_STRING,
+					struct connman_ethernet, interface),
+	CUI_DBUS_DICT_BASIC("Address", DBUS_TYPE_STRING,
+					struct connman_ethernet, address),
+	CUI_DBUS_DICT_BASIC("MTU", DBUS_TYPE_UINT16,
+					struct connman_ethernet, mtu),
+	CUI_DBUS_DICT_BASIC("Speed", DBUS_TYPE_UINT16,
+					struct connman_ethernet, speed),
+	CUI_DBUS_DICT_BASIC("Duplex", DBUS_TYPE_STRING,
+					struct connman_ethernet, duplex),
+	CUI_DBUS_DICT_SPEC_END,
+};
+
+struct dict_description {
+	const struct cui_dbus_dict_spec *spec;
+	size_t size;
+	/* Bit n is set when spec[n] is stored interned */
+	uint32_t interned;
+	/* Whether the structure is kept when the dictionary is empty */
+	gboolean keep_empty;
+};
+
+static const struct dict_description ipv4_dict = {
+	ipv4_spec, sizeof(struct connman_ipv4),
+	1 << 0, FALSE,
+};
+
+static const struct dict_description ipv6_dict = {
+	ipv6_spec, sizeof(struct connman_ipv6),
+	(1 << 0) | (1 << 4), FALSE,
+};
+
+static const struct dict_description proxy_dict = {
+	proxy_spec, sizeof(struct connman_proxy),
+	1 << 0, FALSE,
+};
+
+static const struct dict_description provider_dict = {
+	provider_spec, sizeof(struct connman_provider),
+	1 << 3, FALSE,
+};
+
+static const struct dict_description ethernet_dict = {
+	ethernet_spec, sizeof(struct connman_ethernet),
+	(1 << 0) | (1 << 5), TRUE,
+};
+
+/*
+ * Frees a structure described by dict. Interned strings are never
+ * freed, neither are borrowed ones: only the joined strings are then.
+ */
+static void free_dict(void *data, const struct dict_description *dict,
+							gboolean borrowed)
+{
+	const struct cui_dbus_dict_spec *spec;
+	uint32_t bit;
+
+	if (data == NULL)
+		return;
+
+	for (spec = dict->spec, bit = 1; spec->key.name != NULL;
+							spec++, bit <<= 1) {
+		if (spec->dbus_type != DBUS_TYPE_STRING)
+			continue;
+
+		if ((dict->interned & bit) != 0)
+			continue;
+
+		if (borrowed == TRUE &&
+				spec->entry_type != CUI_DBUS_ENTRY_JOINED)
+			continue;
+
+		g_free(G_STRUCT_MEMBER(char *, data, spec->offset));
+	}
+
+	g_free(data);
+}
+
+static gboolean is_ordered(struct connman_service *service)
+{
+	GPtrArray *ordered = service_if->ordered_services;
+
+	if (service->position >= ordered->len)
+		return FALSE;
+
+	return g_ptr_array_index(ordered, service->position) == service->path;
+}
+
+static void remove_ordered_service(struct connman_service *service)
 {
-	struct connman_ipv4 *ipv4 = data;
+	GPtrArray *ordered = service_if->ordered_services;
+	struct connman_service *next;
+	unsigned int i;
 
-	if (ipv4 == NULL)
+	if (is_ordered(service) == FALSE)
 		return;
 
-	g_free(ipv4->method);
-	g_free(ipv4->address);
-	g_free(ipv4->netmask);
-	g_free(ipv4->gateway);
+	g_ptr_array_remove_index(ordered, service->position);
 
-	g_free(ipv4);
+	for (i = service->position; i < ordered->len; i++) {
+		next = g_hash_table_lookup(service_if->services,
+					g_ptr_array_index(ordered, i));
+		if (next != NULL)
+			next->position = i;
+	}
 }
 
-static void ipv6_free(gpointer data)
+static void free_details(struct service_details *details)
 {
-	struct connman_ipv6 *ipv6 = data;
+	int i;
 
-	if (ipv6 == NULL)
+	if (details == NULL)
 		return;
 
-	g_free(ipv6->method);
-	g_free(ipv6->address);
-	g_free(ipv6->gateway);
-	g_free(ipv6->privacy);
+	if (details->backing[BACKING_ERROR] == NULL)
+		g_free(details->error);
+	g_free(details->nameservers);
+	g_free(details->nameservers_conf);
+	g_free(details->timeservers);
+	g_free(details->timeservers_conf);
+	g_free(details->domains);
+	g_free(details->domains_conf);
+
+	free_dict(details->ipv4, &ipv4_dict,
+				details->backing[BACKING_IPv4] != NULL);
+	free_dict(details->ipv4_conf, &ipv4_dict,
+				details->backing[BACKING_IPv4_CONF] != NULL);
+
+	free_dict(details->ipv6, &ipv6_dict,
+				details->backing[BACKING_IPv6] != NULL);
+	free_dict(details->ipv6_conf, &ipv6_dict,
+				details->backing[BACKING_IPv6_CONF] != NULL);
+
+	free_dict(details->proxy, &proxy_dict,
+				details->backing[BACKING_PROXY] != NULL);
+	free_dict(details->proxy_conf, &proxy_dict,
+				details->backing[BACKING_PROXY_CONF] != NULL);
+
+	free_dict(details->provider, &provider_dict,
+				details->backing[BACKING_PROVIDER] != NULL);
+
+	free_dict(details->ethernet, &ethernet_dict,
+				details->backing[BACKING_ETHERNET] != NULL);
+
+	for (i = 0; i < BACKING_MAX; i++)
+		set_backing(&details->backing[i], NULL);
+
+	set_backing(&details->deferred_message, NULL);
+
+	g_free(details);
+}
+
+static void decode_deferred(struct connman_service *service);
 
-	g_free(ipv6);
+static inline const struct service_details *get_details(
+				const struct connman_service *service)
+{
+	if (service->details == NULL)
+		return &no_details;
+
+	if (service->details->deferred != 0)
+		decode_deferred((struct connman_service *) service);
+
+	return service->details;
+}
+
+static unsigned int latency_bucket(uint32_t latency)
+{
+	unsigned int order;
+
+	if (latency < 8)
+		return latency;
+
+	order = g_bit_storage(latency) - 1;
+
+	return 8 * (order - 2) + ((latency >> (order - 3)) & 7);
+}
+
+/* Highest latency falling in bucket */
+static uint32_t bucket_latency(unsigned int bucket)
+{
+	unsigned int order;
+
+	if (bucket < 8)
+		return bucket;
+
+	order = bucket / 8 + 2;
+
+	return ((uint32_t) (9 + bucket % 8) << (order - 3)) - 1;
 }
 
-static void proxy_free(gpointer data)
+static void histogram_add(struct latency_histogram *histogram,
+							int64_t elapsed)
 {
-	struct connman_proxy *proxy = data;
+	int64_t latency = elapsed / 1000;
 
-	if (proxy == NULL)
+	if (latency > G_MAXUINT32)
+		latency = G_MAXUINT32;
+
+	histogram->buckets[latency_bucket(latency)]++;
+	histogram->count++;
+}
+
+static uint32_t histogram_percentile(const struct latency_histogram *histogram,
+							unsigned int percent)
+{
+	unsigned int rank, seen = 0;
+	int i;
+
+	if (histogram->count == 0)
+		return 0;
+
+	rank = (histogram->count * percent + 99) / 100;
+
+	for (i = 0; i < LATENCY_BUCKETS; i++) {
+		seen += histogram->buckets[i];
+		if (seen >= rank)
+			return bucket_latency(i);
+	}
+
+	return G_MAXUINT32;
+}
+
+static struct connect_stats *get_connect_stats(enum connman_tech_type type)
+{
+	if (type >= CONNMAN_TECH_TYPE_MAX)
+		return NULL;
+
+	if (connect_stats[type] == NULL)
+		connect_stats[type] = g_try_malloc0(
+					sizeof(struct connect_stats));
+
+	return connect_stats[type];
+}
+
+static struct connman_connect_timeline *last_attempt(
+					struct connman_service *service)
+{
+	struct service_timeline *timeline = service->timeline;
+
+	if (timeline == NULL || timeline->count == 0)
+		return NULL;
+
+	return &timeline->attempts[timeline->last];
+}
+
+static void start_connect_timeline(struct connman_service *service)
+{
+	struct connman_connect_timeline *attempt = last_attempt(service);
+	struct service_timeline *timeline;
+	struct connect_stats *stats;
+
+	/* Connecting again while connecting is the same attempt */
+	if (attempt != NULL && attempt->finished == FALSE)
 		return;
 
-	g_free(proxy->method);
-	g_free(proxy->url);
-	g_free(proxy->servers);
-	g_free(proxy->excludes);
+	if (service->timeline == NULL) {
+		service->timeline = g_try_malloc0(
+					sizeof(struct service_timeline));
+		if (service->timeline == NULL)
+			return;
+	}
+
+	timeline = service->timeline;
 
-	g_free(proxy);
+	if (timeline->count > 0)
+		timeline->last = (timeline->last + 1) % CONNECT_TIMELINE_MAX;
+	if (timeline->count < CONNECT_TIMELINE_MAX)
+		timeline->count++;
+
+	attempt = &timeline->attempts[timeline->last];
+	memset(attempt, 0, sizeof(struct connman_connect_timeline));
+	attempt->started = g_get_monotonic_time();
+
+	stats = get_connect_stats(service->type_id);
+	if (stats != NULL)
+		stats->attempts++;
 }
 
-static void provider_free(gpointer data)
+static void record_connect_state(struct connman_service *service,
+							const char *state)
 {
-	struct connman_provider *provider = data;
+	struct connman_connect_timeline *attempt = last_attempt(service);
+	enum connman_connect_step step;
+	struct connect_stats *stats;
+	int64_t elapsed;
+
+	if (attempt == NULL)
+		return;
+
+	if (g_strcmp0(state, "association") == 0)
+		step = CONNMAN_CONNECT_ASSOCIATION;
+	else if (g_strcmp0(state, "configuration") == 0)
+		step = CONNMAN_CONNECT_CONFIGURATION;
+	else if (g_strcmp0(state, "ready") == 0)
+		step = CONNMAN_CONNECT_READY;
+	else if (g_strcmp0(state, "online") == 0)
+		step = CONNMAN_CONNECT_ONLINE;
+	else if (g_strcmp0(state, "failure") == 0)
+		step = CONNMAN_CONNECT_FAILURE;
+	else
+		return;
+
+	/* Being ready ends the attempt, going online still belongs to it */
+	if (attempt->finished == TRUE && (step != CONNMAN_CONNECT_ONLINE ||
+				attempt->step[CONNMAN_CONNECT_READY] == 0))
+		return;
 
-	if (provider == NULL)
+	if (attempt->step[step] != 0)
 		return;
 
-	g_free(provider->host);
-	g_free(provider->domain);
-	g_free(provider->name);
-	g_free(provider->type);
+	elapsed = MAX(g_get_monotonic_time() - attempt->started, 1);
+	attempt->step[step] = elapsed;
 
-	g_free(provider);
+	stats = get_connect_stats(service->type_id);
+
+	switch (step) {
+	case CONNMAN_CONNECT_READY:
+		if (stats != NULL)
+			histogram_add(&stats->ready, elapsed);
+		attempt->finished = TRUE;
+		break;
+	case CONNMAN_CONNECT_ONLINE:
+		if (stats != NULL)
+			histogram_add(&stats->online, elapsed);
+		attempt->finished = TRUE;
+		break;
+	case CONNMAN_CONNECT_FAILURE:
+		if (stats != NULL)
+			stats->failures++;
+		attempt->finished = TRUE;
+		break;
+	default:
+		break;
+	}
 }
 
-static void ethernet_free(gpointer data)
+/* Error may come, or be decoded, after the failure it explains */
+static void record_connect_error(struct connman_service *service,
+							const char *error)
 {
-	struct connman_ethernet *ethernet = data;
+	struct connman_connect_timeline *attempt = last_attempt(service);
 
-	if (ethernet == NULL)
+	if (attempt == NULL || attempt->error != NULL ||
+					error == NULL || *error == '\0')
 		return;
 
-	g_free(ethernet->method);
-	g_free(ethernet->interface);
-	g_free(ethernet->address);
-	g_free(ethernet->duplex);
+	if (attempt->finished == TRUE &&
+				attempt->step[CONNMAN_CONNECT_FAILURE] == 0)
+		return;
 
-	g_free(ethernet);
+	attempt->error = connman_intern(error);
 }
 
-static void service_free(gpointer data)
+static struct service_activity *get_activity(struct connman_service *service)
 {
-	struct connman_service *service = data;
+	if (service->activity == NULL)
+		service->activity = g_try_malloc0(
+					sizeof(struct service_activity));
+
+	return service->activity;
+}
+
+/* Frees the activity of the service once nothing is pending anymore */
+static void release_activity(struct connman_service *service)
+{
+	struct service_activity *activity = service->activity;
 	int i;
 
-	if (service_if != NULL && service_if->selected_service == service)
+	if (activity == NULL)
 		return;
 
-	if (service->property_changed_wid != 0)
-		g_dbus_remove_watch(service_if->dbus_cnx,
-					service->property_changed_wid);
-
 	for (i = 0; i < SERVICE_MAX; i++) {
-		if (service->to_update[i] != 0)
-			g_source_remove(service->to_update[i]);
+		if (activity->call_modify[i] != NULL ||
+					activity->queued_modify[i] != NULL ||
+					activity->to_error[i] != 0)
+			return;
+	}
 
-		if (service->call_modify[i] != 0) {
-			dbus_pending_call_cancel(service->call_modify[i]);
-			dbus_pending_call_unref(service->call_modify[i]);
+	g_free(activity);
+	service->activity = NULL;
+}
+
+static void service_destroy(struct connman_service *service)
+{
+	struct service_activity *activity = service->activity;
+	int i;
+
+	service->activity = NULL;
+
+	for (i = 0; activity != NULL && i < SERVICE_MAX; i++) {
+		if (activity->call_modify[i] != NULL) {
+			dbus_pending_call_cancel(activity->call_modify[i]);
+			dbus_pending_call_unref(activity->call_modify[i]);
+			dbus_message_unref(activity->sent_modify[i]);
 		}
 
-		if (service->to_error[i] != 0)
-			g_source_remove(service->to_error[i]);
+		if (activity->queued_modify[i] != NULL)
+			dbus_message_unref(activity->queued_modify[i]);
+
+		if (activity->to_error[i] != 0)
+			g_source_remove(activity->to_error[i]);
 	}
 
+	g_free(activity);
+
+	__connman_message_drop_templates(service->path);
 	g_free(service->path);
-	g_free(service->error);
-	g_free(service->name);
-	g_free(service->type);
-	g_free(service->security);
-	g_free(service->nameservers);
-	g_free(service->nameservers_conf);
-	g_free(service->timeservers);
-	g_free(service->timeservers_conf);
-	g_free(service->domains);
-	g_free(service->domains_conf);
 
-	ipv4_free(service->ipv4);
-	ipv4_free(service->ipv4_conf);
+	if (service->name_backing == NULL)
+		g_free(service->name);
+	set_backing(&service->name_backing, NULL);
 
-	ipv6_free(service->ipv6);
-	ipv6_free(service->ipv6_conf);
+	free_details(service->details);
+	g_free(service->timeline);
+
+	g_free(service);
+}
 
-	proxy_free(service->proxy);
-	proxy_free(service->proxy_conf);
+static void service_unref(struct connman_service *service)
+{
+	if (--service->refcount > 0)
+		return;
 
-	provider_free(service->provider);
+	service_destroy(service);
+}
 
-	ethernet_free(service->ethernet);
+/* Drops the table's reference: handles may keep the service around */
+static void service_free(gpointer data)
+{
+	struct connman_service *service = data;
+	unsigned int i;
 
-	g_free(service);
+	if (service_if != NULL) {
+		remove_ordered_service(service);
+
+		for (i = 0; service->queued == TRUE &&
+				i < service_if->dirty_services->len; i++) {
+			if (g_ptr_array_index(service_if->dirty_services, i) ==
+								service)
+				service_if->dirty_services->pdata[i] = NULL;
+		}
+		service->queued = FALSE;
+	}
+
+	service_unref(service);
 }
 
 static struct connman_service *get_service(const char *path)
@@ -298,502 +945,708 @@ static void destroy_property(gpointer user_data)
 		return;
 
 	service = get_service(property->path);
-	if (service != NULL) {
-		if (property->error != 0)
-			service->to_error[property->index] = 0;
-		else
-			service->to_update[property->index] = 0;
+	if (service != NULL && service->activity != NULL) {
+		service->activity->to_error[property->index] = 0;
+		release_activity(service);
 	}
 
 	g_free(property);
 }
 
-static gboolean property_changed_or_error(gpointer user_data)
+static gboolean property_error(gpointer user_data)
 {
 	struct property_change *property = user_data;
 	struct connman_service *service;
 
 	service = get_service(property->path);
-	if (service == NULL)
+	if (service == NULL || service->property_set_error_cb == NULL)
 		return FALSE;
 
-	if (property->error != 0) {
-		if (service->property_set_error_cb == NULL)
-			return FALSE;
-
-		service->property_set_error_cb(property->path,
+	service->property_set_error_cb(property->path,
 				property->name, property->error,
 				service->property_set_error_user_data);
+
+	return FALSE;
+}
+
+static void property_update(struct connman_service *service, int index);
+
+/* A service freed from a callback is cleared from dirty_services */
+static gboolean is_flushing(struct connman_service *service,
+							unsigned int position)
+{
+	if (service_if == NULL || position >= service_if->dirty_services->len)
 		return FALSE;
+
+	return g_ptr_array_index(service_if->dirty_services,
+						position) == service;
+}
+
+/* Returns FALSE if the service went away from a callback */
+static gboolean notify_service(struct connman_service *service,
+							unsigned int position)
+{
+	uint32_t dirty = service->dirty;
+	int i;
+
+	service->dirty = 0;
+
+	if (service_if->changed_cb != NULL) {
+		service_if->changed_cb(service->path, dirty,
+					service_if->changed_user_data);
+
+		if (is_flushing(service, position) == FALSE)
+			return FALSE;
 	}
 
-	if (service->property_changed_cb != NULL) {
-		service->property_changed_cb(property->path,
-			property->name, service->property_changed_user_data);
+	for (i = 0; i < SERVICE_MAX; i++) {
+		if ((dirty & (1 << i)) == 0)
+			continue;
+
+		if (service->property_changed_cb == NULL)
+			break;
+
+		service->property_changed_cb(service->path, PROPERTY(i),
+					service->property_changed_user_data);
+
+		if (is_flushing(service, position) == FALSE)
+			return FALSE;
 	}
 
-	return FALSE;
+	return TRUE;
 }
 
-static void property_update(struct connman_service *service, int index)
+static gboolean flush_properties(gpointer user_data)
 {
-	struct property_change *property;
+	struct connman_service *service;
+	GPtrArray *dirty;
+	unsigned int length, i;
 
-	if (service->property_changed_cb == NULL)
-		return;
+	if (service_if == NULL)
+		return FALSE;
 
-	property = g_try_malloc0(sizeof(struct property_change));
-	if (property == NULL)
-		return;
+	service_if->to_flush = 0;
 
-	property->index = index;
-	property->name = PROPERTY(index);
-	property->path = service->path;
+	/* What changes from the callbacks is left to the next flush */
+	dirty = service_if->dirty_services;
+	length = dirty->len;
 
-	if (service->to_update[index] != 0)
-		g_source_remove(service->to_update[index]);
+	/* The callbacks may also clear the queue */
+	for (i = 0; i < length && i < dirty->len; i++) {
+		service = g_ptr_array_index(dirty, i);
+		if (service == NULL)
+			continue;
 
-	service->to_update[index] = g_timeout_add_full(G_PRIORITY_DEFAULT,
-						0, property_changed_or_error,
-						property, destroy_property);
+		if (notify_service(service, i) == FALSE) {
+			if (service_if == NULL)
+				return FALSE;
+
+			continue;
+		}
+
+		dirty->pdata[i] = NULL;
+		service->queued = FALSE;
+
+		if (service->dirty != 0)
+			property_update(service, -1);
+	}
+
+	remove_flushed(dirty, length);
+
+	return FALSE;
 }
 
-static struct connman_ipv4 *parse_ipv4(DBusMessageIter *arg,
-						struct connman_ipv4 *ipv4)
+static void clear_dirty_services(void)
 {
-	DBusMessageIter dict;
-	gboolean set = FALSE;
-	char *value;
+	struct connman_service *service;
+	unsigned int i;
 
-	if (ipv4 == NULL) {
-		ipv4 = g_try_malloc0(sizeof(struct connman_ipv4));
-		if (ipv4 == NULL)
-			return NULL;
+	for (i = 0; i < service_if->dirty_services->len; i++) {
+		service = g_ptr_array_index(service_if->dirty_services, i);
+		if (service == NULL)
+			continue;
+
+		service->dirty = 0;
+		service->queued = FALSE;
 	}
 
-	dbus_message_iter_recurse(arg, &dict);
+	g_ptr_array_set_size(service_if->dirty_services, 0);
+}
 
-	if (cui_dbus_get_dict_entry_basic(&dict, "Method",
-					DBUS_TYPE_STRING, &value) == 0) {
-		g_free(ipv4->method);
-		ipv4->method = g_strdup(value);
-		set = TRUE;
-	}
+/* An index of -1 only queues what is already dirty */
+static void property_update(struct connman_service *service, int index)
+{
+	if (service->property_changed_cb == NULL &&
+					service_if->changed_cb == NULL)
+		return;
 
-	if (cui_dbus_get_dict_entry_basic(&dict, "Address",
-					DBUS_TYPE_STRING, &value) == 0) {
-		g_free(ipv4->address);
-		ipv4->address = g_strdup(value);
-		set = TRUE;
-	}
+	if (index >= 0)
+		service->dirty |= 1 << index;
 
-	if (cui_dbus_get_dict_entry_basic(&dict, "Netmask",
-					DBUS_TYPE_STRING, &value) == 0) {
-		g_free(ipv4->netmask);
-		ipv4->netmask = g_strdup(value);
-		set = TRUE;
+	if (service->queued == FALSE) {
+		service->queued = TRUE;
+		g_ptr_array_add(service_if->dirty_services, service);
 	}
 
-	if (cui_dbus_get_dict_entry_basic(&dict, "Gateway",
-					DBUS_TYPE_STRING, &value) == 0) {
-		g_free(ipv4->gateway);
-		ipv4->gateway = g_strdup(value);
-		set = TRUE;
-	}
+	if (service_if->to_flush == 0)
+		service_if->to_flush = g_timeout_add_full(G_PRIORITY_DEFAULT,
+					0, flush_properties, NULL, NULL);
+}
 
-	if (set == TRUE)
-		return ipv4;
+/*
+ * Copies what cui_dbus_get_dict() found in values into target, both
+ * being the same structure described by dict. When borrowed, target
+ * and values are the same structure and only interning is done.
+ */
+static void merge_dict_values(void *target, void *values,
+			const struct dict_description *dict, uint32_t found,
+			gboolean borrowed)
+{
+	const struct cui_dbus_dict_spec *spec;
+	uint32_t bit;
 
-	g_free(ipv4);
-	return NULL;
+	for (spec = dict->spec, bit = 1; spec->key.name != NULL;
+							spec++, bit <<= 1) {
+		void *field = G_STRUCT_MEMBER_P(target, spec->offset);
+		void *value = G_STRUCT_MEMBER_P(values, spec->offset);
+
+		if ((found & bit) == 0)
+			continue;
+
+		if ((dict->interned & bit) != 0) {
+			*(const char **) field = connman_intern(
+						*(const char **) value);
+			continue;
+		}
+
+		if (borrowed == TRUE)
+			continue;
+
+		/* Joined strings are allocated by the decoder */
+		if (spec->entry_type == CUI_DBUS_ENTRY_JOINED) {
+			g_free(*(char **) field);
+			*(char **) field = *(char **) value;
+			continue;
+		}
+
+		switch (spec->dbus_type) {
+		case DBUS_TYPE_STRING:
+			g_free(*(char **) field);
+			*(char **) field = g_strdup(*(char **) value);
+			break;
+		case DBUS_TYPE_BYTE:
+			*(uint8_t *) field = *(uint8_t *) value;
+			break;
+		case DBUS_TYPE_UINT16:
+			*(uint16_t *) field = *(uint16_t *) value;
+			break;
+		default:
+			break;
+		}
+	}
 }
 
-static struct connman_ipv6 *parse_ipv6(DBusMessageIter *arg,
-						struct connman_ipv6 *ipv6)
+/* Whether the fields of mask differ between a and b, described by dict */
+static gboolean dict_differs(void *a, void *b,
+			const struct dict_description *dict, uint32_t mask)
 {
-	uint16_t uint16_value;
-	DBusMessageIter dict;
-	gboolean set = FALSE;
-	char *value;
+	const struct cui_dbus_dict_spec *spec;
+	uint32_t bit;
 
-	if (ipv6 == NULL) {
-		ipv6 = g_try_malloc0(sizeof(struct connman_ipv6));
-		if (ipv6 == NULL)
-			return NULL;
-	}
+	if (a == NULL || b == NULL)
+		return a != b;
 
-	dbus_message_iter_recurse(arg, &dict);
+	for (spec = dict->spec, bit = 1; spec->key.name != NULL;
+							spec++, bit <<= 1) {
+		void *field_a = G_STRUCT_MEMBER_P(a, spec->offset);
+		void *field_b = G_STRUCT_MEMBER_P(b, spec->offset);
 
-	if (cui_dbus_get_dict_entry_basic(&dict, "Method",
-					DBUS_TYPE_STRING, &value) == 0) {
-		g_free(ipv6->method);
-		ipv6->method = g_strdup(value);
-		set = TRUE;
-	}
+		if ((mask & bit) == 0)
+			continue;
 
-	if (cui_dbus_get_dict_entry_basic(&dict, "Address",
-					DBUS_TYPE_STRING, &value) == 0) {
-		g_free(ipv6->address);
-		ipv6->address = g_strdup(value);
-		set = TRUE;
+		switch (spec->dbus_type) {
+		case DBUS_TYPE_STRING:
+			if (g_strcmp0(*(char **) field_a,
+						*(char **) field_b) != 0)
+				return TRUE;
+			break;
+		case DBUS_TYPE_BYTE:
+			if (*(uint8_t *) field_a != *(uint8_t *) field_b)
+				return TRUE;
+			break;
+		case DBUS_TYPE_UINT16:
+			if (*(uint16_t *) field_a != *(uint16_t *) field_b)
+				return TRUE;
+			break;
+		default:
+			break;
+		}
 	}
 
-	if (cui_dbus_get_dict_entry_basic(&dict, "Prefix",
-				DBUS_TYPE_UINT16, &uint16_value) == 0) {
-		ipv6->prefix = uint16_value;
-		set = TRUE;
+	return FALSE;
+}
+
+/*
+ * Updates target, a structure described by dict, from the dictionary
+ * in arg. When message is set, the strings are borrowed from it and
+ * the whole structure is replaced instead of being merged. Returns NULL
+ * if nothing was found, unless the structure is to be kept empty.
+ * changed tells whether the values differ from the previous ones.
+ */
+static void *parse_dict(DBusMessageIter *arg, void *target, void *values,
+			const struct dict_description *dict,
+			DBusMessage **backing, DBusMessage *message,
+			gboolean *changed)
+{
+	DBusMessage *previous_backing = *backing;
+	void *previous = target;
+	gboolean replace = FALSE;
+	DBusMessageIter array;
+	uint32_t found;
+
+	*changed = FALSE;
+
+	/* The previous structure is kept until compared to the new one */
+	if (message != NULL || previous_backing != NULL) {
+		replace = TRUE;
+		*backing = NULL;
+		target = NULL;
 	}
 
-	if (cui_dbus_get_dict_entry_basic(&dict, "Gateway",
-					DBUS_TYPE_STRING, &value) == 0) {
-		g_free(ipv6->gateway);
-		ipv6->gateway = g_strdup(value);
-		set = TRUE;
+	if (target == NULL) {
+		target = g_try_malloc0(dict->size);
+		if (target == NULL)
+			goto done;
 	}
 
-	if (cui_dbus_get_dict_entry_basic(&dict, "Privacy",
-					DBUS_TYPE_STRING, &value) == 0) {
-		g_free(ipv6->privacy);
-		ipv6->privacy = g_strdup(value);
-		set = TRUE;
+	/* Borrowed values are decoded straight into the new structure */
+	if (message != NULL)
+		values = target;
+	else
+		memset(values, 0, dict->size);
+
+	dbus_message_iter_recurse(arg, &array);
+
+	if (cui_dbus_get_dict(&array, dict->spec, values, &found) < 0)
+		found = 0;
+
+	if (target == previous)
+		*changed = dict_differs(target, values, dict, found);
+
+	merge_dict_values(target, values, dict, found, message != NULL);
+
+	if (found == 0 && dict->keep_empty == FALSE) {
+		free_dict(target, dict, FALSE);
+		target = NULL;
+	} else if (message != NULL)
+		set_backing(backing, message);
+
+done:
+	if (target != previous)
+		*changed = dict_differs(previous, target, dict, ~0U);
+
+	if (replace == TRUE) {
+		free_dict(previous, dict, previous_backing != NULL);
+		set_backing(&previous_backing, NULL);
 	}
 
-	if (set == TRUE)
-		return ipv6;
+	return target;
+}
 
-	g_free(ipv6);
-	return NULL;
+static struct connman_ipv4 *parse_ipv4(DBusMessageIter *arg,
+			struct connman_ipv4 *ipv4, DBusMessage **backing,
+			DBusMessage *message, gboolean *changed)
+{
+	struct connman_ipv4 values;
+
+	return parse_dict(arg, ipv4, &values, &ipv4_dict, backing, message,
+								changed);
+}
+
+static struct connman_ipv6 *parse_ipv6(DBusMessageIter *arg,
+			struct connman_ipv6 *ipv6, DBusMessage **backing,
+			DBusMessage *message, gboolean *changed)
+{
+	struct connman_ipv6 values;
+
+	return parse_dict(arg, ipv6, &values, &ipv6_dict, backing, message,
+								changed);
 }
 
 static struct connman_proxy *parse_proxy(DBusMessageIter *arg,
-						struct connman_proxy *proxy)
+			struct connman_proxy *proxy, DBusMessage **backing,
+			DBusMessage *message, gboolean *changed)
 {
-	DBusMessageIter dict;
-	gboolean set = FALSE;
-	char *value, **array;
-	int length;
+	struct connman_proxy values;
 
-	if (proxy == NULL) {
-		proxy = g_try_malloc0(sizeof(struct connman_proxy));
-		if (proxy == NULL)
-			return NULL;
-	}
+	return parse_dict(arg, proxy, &values, &proxy_dict, backing, message,
+								changed);
+}
 
-	dbus_message_iter_recurse(arg, &dict);
+static struct connman_provider *parse_provider(DBusMessageIter *arg,
+		struct connman_provider *provider, DBusMessage **backing,
+		DBusMessage *message, gboolean *changed)
+{
+	struct connman_provider values;
 
-	if (cui_dbus_get_dict_entry_basic(&dict, "Method",
-					DBUS_TYPE_STRING, &value) == 0) {
-		g_free(proxy->method);
-		proxy->method = g_strdup(value);
-		set = TRUE;
-	}
+	return parse_dict(arg, provider, &values, &provider_dict,
+						backing, message, changed);
+}
 
-	if (cui_dbus_get_dict_entry_basic(&dict, "URL",
-					DBUS_TYPE_STRING, &value) == 0) {
-		g_free(proxy->url);
-		proxy->url = g_strdup(value);
-		set = TRUE;
-	}
+static struct connman_ethernet *parse_ethernet(DBusMessageIter *arg,
+		struct connman_ethernet *ethernet, DBusMessage **backing,
+		DBusMessage *message, gboolean *changed)
+{
+	struct connman_ethernet values;
 
-	if (cui_dbus_get_dict_entry_array(&dict, "Servers",
-				DBUS_TYPE_STRING, &length, &array) == 0) {
-		g_free(proxy->servers);
-		if (array != NULL) {
-			proxy->servers = g_strjoinv(";", array);
-			g_free(array);
-		} else
-			proxy->servers = NULL;
+	return parse_dict(arg, ethernet, &values, &ethernet_dict,
+						backing, message, changed);
+}
 
-		set = TRUE;
-	}
+static char *join_string_array(DBusMessageIter *arg, char *previous)
+{
+	char *joined;
 
-	if (cui_dbus_get_dict_entry_array(&dict, "Excludes",
-				DBUS_TYPE_STRING, &length, &array) == 0) {
-		g_free(proxy->excludes);
-		if (array != NULL) {
-			proxy->excludes = g_strjoinv(";", array);
-			g_free(array);
-		} else
-			proxy->excludes = NULL;
+	g_free(previous);
 
-		set = TRUE;
-	}
+	if (cui_dbus_get_string_array_joined(arg,
+				CUI_DBUS_JOINED_SEPARATOR, &joined) < 0)
+		return NULL;
 
-	if (set == TRUE)
-		return proxy;
+	return joined;
+}
 
-	g_free(proxy);
-	return NULL;
+static const char *intern_string_array(DBusMessageIter *arg)
+{
+	const char *interned;
+	char buffer[64];
+	char *joined;
+	int length;
+
+	length = cui_dbus_join_string_array(arg, CUI_DBUS_JOINED_SEPARATOR,
+						buffer, sizeof(buffer));
+	if (length <= 0)
+		return NULL;
+
+	if (length < (int) sizeof(buffer))
+		return connman_intern(buffer);
+
+	if (cui_dbus_get_string_array_joined(arg,
+				CUI_DBUS_JOINED_SEPARATOR, &joined) < 0)
+		return NULL;
+
+	interned = connman_intern(joined);
+	g_free(joined);
+
+	return interned;
 }
 
-static struct connman_provider *parse_provider(DBusMessageIter *arg,
-					struct connman_provider *provider)
+/* Whether the variant holds an empty string, array or dictionary */
+static gboolean is_empty_variant(DBusMessageIter *arg)
 {
-	DBusMessageIter dict;
-	gboolean set = FALSE;
-	char *value;
+	DBusMessageIter value, array;
+	const char *string;
 
-	if (provider == NULL) {
-		provider = g_try_malloc0(sizeof(struct connman_provider));
-		if (provider == NULL)
-			return NULL;
-	}
+	if (dbus_message_iter_get_arg_type(arg) != DBUS_TYPE_VARIANT)
+		return FALSE;
 
-	dbus_message_iter_recurse(arg, &dict);
+	dbus_message_iter_recurse(arg, &value);
 
-	if (cui_dbus_get_dict_entry_basic(&dict, "Host",
-					DBUS_TYPE_STRING, &value) == 0) {
-		g_free(provider->host);
-		provider->host = g_strdup(value);
-		set = TRUE;
+	switch (dbus_message_iter_get_arg_type(&value)) {
+	case DBUS_TYPE_STRING:
+		dbus_message_iter_get_basic(&value, &string);
+		return string[0] == '\0';
+	case DBUS_TYPE_ARRAY:
+		dbus_message_iter_recurse(&value, &array);
+		return dbus_message_iter_get_arg_type(&array) ==
+							DBUS_TYPE_INVALID;
+	default:
+		break;
 	}
 
-	if (cui_dbus_get_dict_entry_basic(&dict, "Domain",
-					DBUS_TYPE_STRING, &value) == 0) {
-		g_free(provider->domain);
-		provider->domain = g_strdup(value);
-		set = TRUE;
-	}
+	return FALSE;
+}
 
-	if (cui_dbus_get_dict_entry_basic(&dict, "Name",
-					DBUS_TYPE_STRING, &value) == 0) {
-		g_free(provider->name);
-		provider->name = g_strdup(value);
-		set = TRUE;
-	}
+/* Returns whether a dictionary field changed, FALSE for the others */
+static gboolean decode_property(struct connman_service *service, int index,
+							DBusMessageIter *arg)
+{
+	DBusMessage *message = service->update_message;
+	struct service_details *details = service->details;
+	gboolean changed = FALSE;
+	const char *value = NULL;
+	gboolean boolean_value;
+	uint8_t uint8_value;
 
-	if (cui_dbus_get_dict_entry_basic(&dict, "Type",
-					DBUS_TYPE_STRING, &value) == 0) {
-		g_free(provider->type);
-		provider->type = g_strdup(value);
-		set = TRUE;
+	switch (index) {
+	case SERVICE_NAME:
+		cui_dbus_get_basic_variant(arg, DBUS_TYPE_STRING, &value);
+		service->name = update_string(service->name, value,
+				&service->name_backing, message);
+		break;
+	case SERVICE_TYPE:
+		cui_dbus_get_basic_variant(arg, DBUS_TYPE_STRING, &value);
+		service->type = connman_intern(value);
+		service->type_id = string2enum_tech_type(value);
+		break;
+	case SERVICE_SECURITY:
+		service->security = intern_string_array(arg);
+		break;
+	case SERVICE_IMMUTABLE:
+		cui_dbus_get_basic_variant(arg,
+				DBUS_TYPE_BOOLEAN, &boolean_value);
+		service->immutable = boolean_value;
+		break;
+	case SERVICE_STATE:
+		cui_dbus_get_basic_variant(arg, DBUS_TYPE_STRING, &value);
+		service->state = string2enum_state(value);
+		record_connect_state(service, value);
+		break;
+	case SERVICE_ERROR:
+		cui_dbus_get_basic_variant(arg, DBUS_TYPE_STRING, &value);
+		details->error = update_string(details->error, value,
+				&details->backing[BACKING_ERROR], message);
+		record_connect_error(service, value);
+		break;
+	case SERVICE_STRENGTH:
+		cui_dbus_get_basic_variant(arg, DBUS_TYPE_BYTE, &uint8_value);
+		service->strength = uint8_value;
+		break;
+	case SERVICE_FAVORITE:
+		cui_dbus_get_basic_variant(arg,
+				DBUS_TYPE_BOOLEAN, &boolean_value);
+		service->favorite = boolean_value;
+		break;
+	case SERVICE_AUTOCONNECT:
+		cui_dbus_get_basic_variant(arg,
+				DBUS_TYPE_BOOLEAN, &boolean_value);
+		service->autoconnect = boolean_value;
+		break;
+	case SERVICE_ROAMING:
+		cui_dbus_get_basic_variant(arg,
+				DBUS_TYPE_BOOLEAN, &boolean_value);
+		service->roaming = boolean_value;
+		break;
+	case SERVICE_NAMESERVERS:
+		details->nameservers = join_string_array(arg,
+							details->nameservers);
+		break;
+	case SERVICE_NAMESERVERS_CONFIGURATION:
+		details->nameservers_conf = join_string_array(arg,
+						details->nameservers_conf);
+		break;
+	case SERVICE_DOMAINS:
+		details->domains = join_string_array(arg, details->domains);
+		break;
+	case SERVICE_DOMAINS_CONFIGURATION:
+		details->domains_conf = join_string_array(arg,
+						details->domains_conf);
+		break;
+	case SERVICE_TIMESERVERS:
+		details->timeservers = join_string_array(arg,
+							details->timeservers);
+		break;
+	case SERVICE_TIMESERVERS_CONFIGURATION:
+		details->timeservers_conf = join_string_array(arg,
+						details->timeservers_conf);
+		break;
+	case SERVICE_IPv4:
+		details->ipv4 = parse_ipv4(arg, details->ipv4,
+				&details->backing[BACKING_IPv4], message,
+				&changed);
+		break;
+	case SERVICE_IPv4_CONFIGURATION:
+		details->ipv4_conf = parse_ipv4(arg, details->ipv4_conf,
+				&details->backing[BACKING_IPv4_CONF], message,
+				&changed);
+		break;
+	case SERVICE_IPv6:
+		details->ipv6 = parse_ipv6(arg, details->ipv6,
+				&details->backing[BACKING_IPv6], message,
+				&changed);
+		break;
+	case SERVICE_IPv6_CONFIGURATION:
+		details->ipv6_conf = parse_ipv6(arg, details->ipv6_conf,
+				&details->backing[BACKING_IPv6_CONF], message,
+				&changed);
+		break;
+	case SERVICE_PROXY:
+		details->proxy = parse_proxy(arg, details->proxy,
+				&details->backing[BACKING_PROXY], message,
+				&changed);
+		break;
+	case SERVICE_PROXY_CONFIGURATION:
+		details->proxy_conf = parse_proxy(arg, details->proxy_conf,
+				&details->backing[BACKING_PROXY_CONF], message,
+				&changed);
+		break;
+	case SERVICE_PROVIDER:
+		details->provider = parse_provider(arg, details->provider,
+				&details->backing[BACKING_PROVIDER], message,
+				&changed);
+		break;
+	case SERVICE_ETHERNET:
+		details->ethernet = parse_ethernet(arg, details->ethernet,
+				&details->backing[BACKING_ETHERNET], message,
+				&changed);
+		break;
+	default:
+		break;
 	}
 
-	if (set == TRUE)
-		return provider;
+	return changed;
+}
 
-	g_free(provider);
-	return NULL;
+/* Only changes are stamped, and the first value a field gets */
+static void stamp_field(struct connman_service *service, int index,
+							gboolean changed)
+{
+	if (index < 0 || index >= SERVICE_FIELD_MAX)
+		return;
+
+	if (changed == FALSE && service->field_generation[index] != 0)
+		return;
+
+	service->generation = __connman_generation_next();
+	service->field_generation[index] = service->generation;
 }
 
-static struct connman_ethernet *parse_ethernet(DBusMessageIter *arg,
-					struct connman_ethernet *ethernet)
+static gboolean is_dict_field(int index)
 {
-	uint16_t uint16_value;
-	DBusMessageIter dict;
-	char *value;
+	return index >= 0 && index < SERVICE_MAX &&
+				(SERVICE_DICT_FIELDS & (1U << index)) != 0;
+}
 
-	if (ethernet == NULL) {
-		ethernet = g_try_malloc0(sizeof(struct connman_ethernet));
-		if (ethernet == NULL)
-			return NULL;
-	};
+/* Decodes what was left undecoded from the last services list */
+static bool decode_deferred_property(DBusMessageIter *arg, void *user_data)
+{
+	struct connman_service *service = user_data;
+	gboolean changed;
+	const char *name;
+	int index;
 
-	dbus_message_iter_recurse(arg, &dict);
+	if (cui_dbus_get_basic(arg, DBUS_TYPE_STRING, &name) != 0)
+		return FALSE;
 
-	if (cui_dbus_get_dict_entry_basic(&dict, "Method",
-					DBUS_TYPE_STRING, &value) == 0) {
-		g_free(ethernet->method);
-		ethernet->method = g_strdup(value);
-	}
+	dbus_message_iter_next(arg);
+
+	index = service_property_index(name);
+	if (index < 0 || index >= SERVICE_MAX ||
+			(service->details->deferred & (1U << index)) == 0)
+		return FALSE;
+
+	changed = decode_property(service, index, arg);
+
+	/* The other fields were stamped from the list they came with */
+	if (is_dict_field(index) == TRUE)
+		stamp_field(service, index, changed);
+
+	return FALSE;
+}
+
+static void decode_deferred_fields(struct connman_service *service,
+							uint32_t fields)
+{
+	struct service_details *details = service->details;
+	DBusMessageIter dict = details->deferred_dict;
+	DBusMessage *update_message = service->update_message;
+	uint32_t deferred = details->deferred;
+
+	details->deferred = fields;
+	service->update_message = borrow_strings == TRUE ?
+					details->deferred_message : NULL;
 
-	if (cui_dbus_get_dict_entry_basic(&dict, "Interface",
-					DBUS_TYPE_STRING, &value) == 0) {
-		g_free(ethernet->interface);
-		ethernet->interface = g_strdup(value);
-	}
+	cui_dbus_foreach_dict_entry(&dict, decode_deferred_property, service);
 
-	if (cui_dbus_get_dict_entry_basic(&dict, "Address",
-					DBUS_TYPE_STRING, &value) == 0) {
-		g_free(ethernet->address);
-		ethernet->address = g_strdup(value);
-	}
+	service->update_message = update_message;
+	details->deferred = deferred & ~fields;
+}
 
-	if (cui_dbus_get_dict_entry_basic(&dict, "MTU",
-				DBUS_TYPE_UINT16, &uint16_value) == 0)
-		ethernet->mtu = uint16_value;
+static void decode_deferred(struct connman_service *service)
+{
+	decode_deferred_fields(service, service->details->deferred);
 
+	set_backing(&service->details->deferred_message, NULL);
+}
 
-	if (cui_dbus_get_dict_entry_basic(&dict, "Speed",
-				DBUS_TYPE_UINT16, &uint16_value) == 0)
-		ethernet->speed = uint16_value;
+static void keep_deferred_message(struct connman_service *service,
+				DBusMessage *message, DBusMessageIter *dict)
+{
+	struct service_details *details = service->details;
 
-	if (cui_dbus_get_dict_entry_basic(&dict, "Duplex",
-					DBUS_TYPE_STRING, &value) == 0) {
-		g_free(ethernet->duplex);
-		ethernet->duplex = g_strdup(value);
+	if (details == NULL || details->deferred == 0) {
+		if (details != NULL)
+			set_backing(&details->deferred_message, NULL);
+		return;
 	}
 
-	return ethernet;
+	details->deferred_dict = *dict;
+	set_backing(&details->deferred_message, message);
 }
 
 static bool update_service_property(DBusMessageIter *arg, void *user_data)
 {
 	struct connman_service *service = user_data;
-	const char *name, *value;
-	gboolean boolean_value;
-	char **array;
-	int length;
+	struct service_details *details = service->details;
+	gboolean changed = FALSE;
+	const char *name;
+	uint32_t hash;
+	int index;
 
 	if (cui_dbus_get_basic(arg, DBUS_TYPE_STRING, &name) != 0)
 		return FALSE;
 
 	dbus_message_iter_next(arg);
 
-	if (g_strcmp0(name, "Name") == 0) {
-		cui_dbus_get_basic_variant(arg, DBUS_TYPE_STRING, &value);
-		service->name = g_strdup(value);
-	} else if (g_strcmp0(name, "Type") == 0) {
-		cui_dbus_get_basic_variant(arg, DBUS_TYPE_STRING, &value);
-		service->type = g_strdup(value);
-	} else if (g_strcmp0(name, "Security") == 0) {
-		cui_dbus_get_array(arg, DBUS_TYPE_STRING, &length, &array);
-
-		g_free(service->security);
-		if (array != NULL) {
-			service->security = g_strjoinv(";", array);
-			g_free(array);
-		} else
-			service->security = NULL;
-	} else if (g_strcmp0(name, "Immutable") == 0) {
-		cui_dbus_get_basic_variant(arg,
-				DBUS_TYPE_BOOLEAN, &boolean_value);
-		service->immutable = boolean_value;
-	} else if (g_strcmp0(name, PROPERTY(SERVICE_STATE)) == 0) {
-		cui_dbus_get_basic_variant(arg, DBUS_TYPE_STRING, &value);
-
-		service->state = string2enum_state(value);
-
-		service->update_index = SERVICE_STATE;
-	} else if (g_strcmp0(name, PROPERTY(SERVICE_ERROR)) == 0) {
-		cui_dbus_get_basic_variant(arg, DBUS_TYPE_STRING, &value);
-
-		g_free(service->error);
-		service->error = g_strdup(value);
-
-		service->update_index = SERVICE_ERROR;
-	} else if (g_strcmp0(name, PROPERTY(SERVICE_STRENGTH)) == 0) {
-		uint8_t uint8_value;
-
-		cui_dbus_get_basic_variant(arg, DBUS_TYPE_BYTE, &uint8_value);
-		service->strength = uint8_value;
-
-		service->update_index = SERVICE_STRENGTH;
-	} else if (g_strcmp0(name, PROPERTY(SERVICE_FAVORITE)) == 0) {
-		cui_dbus_get_basic_variant(arg,
-				DBUS_TYPE_BOOLEAN, &boolean_value);
-		service->favorite = boolean_value;
-
-		service->update_index = SERVICE_FAVORITE;
-	} else if (g_strcmp0(name, PROPERTY(SERVICE_AUTOCONNECT)) == 0) {
-		cui_dbus_get_basic_variant(arg,
-				DBUS_TYPE_BOOLEAN, &boolean_value);
-		service->autoconnect = boolean_value;
-
-		service->update_index = SERVICE_AUTOCONNECT;
-	} else if (g_strcmp0(name, PROPERTY(SERVICE_ROAMING)) == 0) {
-		cui_dbus_get_basic_variant(arg,
-				DBUS_TYPE_BOOLEAN, &boolean_value);
-		service->roaming = boolean_value;
-
-		service->update_index = SERVICE_ROAMING;
-	} else if (g_strcmp0(name, PROPERTY(SERVICE_NAMESERVERS)) == 0) {
-		cui_dbus_get_array(arg, DBUS_TYPE_STRING, &length, &array);
-
-		g_free(service->nameservers);
-		if (array != NULL) {
-			service->nameservers = g_strjoinv(";", array);
-			g_free(array);
-		} else
-			service->nameservers = NULL;
+	index = service_property_index(name);
 
-		service->update_index = SERVICE_NAMESERVERS;
-	} else if (g_strcmp0(name,
-			PROPERTY(SERVICE_NAMESERVERS_CONFIGURATION)) == 0) {
-		cui_dbus_get_array(arg, DBUS_TYPE_STRING, &length, &array);
+	/*
+	 * Services lists resend every value, changed or not: scalars and
+	 * string arrays are hashed, dictionaries compared once decoded.
+	 */
+	if (index >= 0 && index < SERVICE_FIELD_MAX &&
+					is_dict_field(index) == FALSE) {
+		hash = cui_dbus_hash_value(arg);
 
-		g_free(service->nameservers_conf);
-		if (array != NULL) {
-			service->nameservers_conf = g_strjoinv(";", array);
-			g_free(array);
-		} else
-			 service->nameservers_conf = NULL;
+		changed = service->field_hash[index] != hash;
+		service->field_hash[index] = hash;
+	}
 
-		service->update_index = SERVICE_NAMESERVERS_CONFIGURATION;
-	} else if (g_strcmp0(name, PROPERTY(SERVICE_DOMAINS)) == 0) {
-		cui_dbus_get_array(arg, DBUS_TYPE_STRING, &length, &array);
+	if (index >= 0 && index < SERVICE_MAX &&
+			(SERVICE_DETAILS_FIELDS & (1U << index)) != 0) {
+		if (details == NULL) {
+			/* An empty Ethernet dictionary is still kept */
+			if (index != SERVICE_ETHERNET &&
+					is_empty_variant(arg) == TRUE)
+				goto stamp;
 
-		g_free(service->domains);
-		if (array != NULL) {
-			service->domains = g_strjoinv(";", array);
-			g_free(array);
-		} else
-			service->domains = NULL;
+			details = g_try_malloc0(
+					sizeof(struct service_details));
+			if (details == NULL)
+				return FALSE;
 
-		service->update_index = SERVICE_DOMAINS;
-	} else if (g_strcmp0(name,
-			PROPERTY(SERVICE_DOMAINS_CONFIGURATION)) == 0) {
-		cui_dbus_get_array(arg, DBUS_TYPE_STRING, &length, &array);
+			service->details = details;
+		}
 
-		g_free(service->domains_conf);
-		if (array != NULL) {
-			service->domains_conf = g_strjoinv(";", array);
-			g_free(array);
-		} else
-			service->domains_conf = NULL;
+		/* Deferred dictionaries are stamped once decoded */
+		if (service->defer_details == TRUE) {
+			details->deferred |= 1U << index;
+			goto stamp;
+		}
 
-		service->update_index = SERVICE_DOMAINS_CONFIGURATION;
-	} else if (g_strcmp0(name, PROPERTY(SERVICE_TIMESERVERS)) == 0) {
-		cui_dbus_get_array(arg, DBUS_TYPE_STRING, &length, &array);
+		details->deferred &= ~(1U << index);
+		if (details->deferred == 0)
+			set_backing(&details->deferred_message, NULL);
+	}
 
-		g_free(service->timeservers);
-		if (array != NULL) {
-			service->timeservers = g_strjoinv(";", array);
-			g_free(array);
-		} else
-			service->timeservers = NULL;
+	if (decode_property(service, index, arg) == TRUE)
+		changed = TRUE;
 
-		service->update_index = SERVICE_TIMESERVERS;
-	} else if (g_strcmp0(name,
-			PROPERTY(SERVICE_TIMESERVERS_CONFIGURATION)) == 0) {
-		cui_dbus_get_array(arg, DBUS_TYPE_STRING, &length, &array);
+stamp:
+	stamp_field(service, index, changed);
 
-		g_free(service->timeservers_conf);
-		if (array != NULL) {
-			service->timeservers_conf = g_strjoinv(";", array);
-			g_free(array);
-		} else
-			service->timeservers_conf = NULL;
-
-		service->update_index = SERVICE_TIMESERVERS_CONFIGURATION;
-	} else if (g_strcmp0(name, PROPERTY(SERVICE_IPv4)) == 0) {
-		service->ipv4 = parse_ipv4(arg, service->ipv4);
-		service->update_index = SERVICE_IPv4;
-	} else if (g_strcmp0(name,
-			PROPERTY(SERVICE_IPv4_CONFIGURATION)) == 0) {
-		service->ipv4_conf = parse_ipv4(arg, service->ipv4_conf);
-		service->update_index = SERVICE_IPv4_CONFIGURATION;
-	} else if (g_strcmp0(name, PROPERTY(SERVICE_IPv6)) == 0) {
-		service->ipv6 = parse_ipv6(arg, service->ipv6);
-		service->update_index = SERVICE_IPv6;
-	} else if (g_strcmp0(name,
-			PROPERTY(SERVICE_IPv6_CONFIGURATION)) == 0) {
-		service->ipv6_conf = parse_ipv6(arg, service->ipv6_conf);
-		service->update_index = SERVICE_IPv6_CONFIGURATION;
-	} else if (g_strcmp0(name, PROPERTY(SERVICE_PROXY)) == 0) {
-		service->proxy = parse_proxy(arg, service->proxy);
-		service->update_index = SERVICE_PROXY;
-	} else if (g_strcmp0(name,
-			PROPERTY(SERVICE_PROXY_CONFIGURATION)) == 0) {
-		service->proxy_conf = parse_proxy(arg, service->proxy_conf);
-		service->update_index = SERVICE_PROXY_CONFIGURATION;
-	} else if (g_strcmp0(name, PROPERTY(SERVICE_PROVIDER)) == 0) {
-		service->provider = parse_provider(arg, service->provider);
-		service->update_index = SERVICE_PROVIDER;
-	} else if (g_strcmp0(name, PROPERTY(SERVICE_ETHERNET)) == 0) {
-		service->ethernet = parse_ethernet(arg, service->ethernet);
-		service->update_index = SERVICE_ETHERNET;
-	}
+	if (index >= 0 && index < SERVICE_MAX)
+		service->update_index = index;
 
 	return FALSE;
 }
@@ -801,63 +1654,95 @@ static bool update_service_property(DBusMessageIter *arg, void *user_data)
 static gboolean property_changed_signal_cb(DBusConnection *dbus_cnx,
 					DBusMessage *message, void *user_data)
 {
-	struct connman_service *service = user_data;
+	struct connman_service *service;
 	DBusMessageIter arg;
 
 	if (message == NULL)
 		return TRUE;
 
+	service = get_service(dbus_message_get_path(message));
+	if (service == NULL)
+		return TRUE;
+
 	if (dbus_message_iter_init(message, &arg) == FALSE)
 		return TRUE;
 
 	service->update_index = SERVICE_MAX;
+	service->update_message = borrow_strings == TRUE ? message : NULL;
 
 	update_service_property(&arg, service);
 
+	service->update_message = NULL;
+
 	if (service->update_index < SERVICE_MAX)
 		property_update(service, service->update_index);
 
 	return TRUE;
 }
 
-static void update_or_create_service(const char *obj_path,
-					DBusMessageIter *dict)
+static void update_or_create_service(DBusMessage *message,
+				const char *obj_path, DBusMessageIter *dict)
 {
 	struct connman_service *service;
+	uint32_t outstanding = 0;
 
 	if (service_if == NULL)
 		return;
 
-	service = get_service(obj_path);
+	service = g_hash_table_lookup(service_if->services, obj_path);
 	if (service == NULL) {
 		service = g_try_malloc0(sizeof(struct connman_service));
 		if (service == NULL)
 			return;
 
+		service->refcount = 1;
 		service->path = g_strdup(obj_path);
 
 		g_hash_table_insert(service_if->services,
 					service->path, service);
-
-		service->property_changed_wid = g_dbus_add_signal_watch(
-						service_if->dbus_cnx,
-						CONNMAN_DBUS_NAME,
-						service->path,
-						CONNMAN_SERVICE_INTERFACE,
-						"PropertyChanged",
-						property_changed_signal_cb,
-						service, NULL);
 	}
 
-	service_if->ordered_services = g_slist_append(
-				service_if->ordered_services, service->path);
+	service->position = service_if->ordered_services->len;
+	g_ptr_array_add(service_if->ordered_services, service->path);
+
+	service->update_message = borrow_strings == TRUE ? message : NULL;
+
+	if (lazy_details == TRUE) {
+		/* Fields the new list carries are deferred to it instead */
+		if (service->details != NULL) {
+			outstanding = service->details->deferred;
+			service->details->deferred = 0;
+		}
+
+		service->defer_details = TRUE;
+	}
 
 	cui_dbus_foreach_dict_entry(dict, update_service_property, service);
+
+	if (service->defer_details == TRUE) {
+		service->defer_details = FALSE;
+
+		/* The others are only in the previous list, about to go */
+		if (outstanding != 0) {
+			outstanding &= ~service->details->deferred;
+			if (outstanding != 0)
+				decode_deferred_fields(service, outstanding);
+		}
+
+		keep_deferred_message(service, message, dict);
+	}
+
+	service->update_message = NULL;
 }
 
 gboolean refresh_cb(gpointer data)
 {
-	if (service_if == NULL || service_if->refresh_services_cb == NULL)
+	if (service_if == NULL)
+		return FALSE;
+
+	service_if->to_refresh = 0;
+
+	if (service_if->refresh_services_cb == NULL)
 		return FALSE;
 
 	service_if->refresh_services_cb(service_if->refresh_user_data);
@@ -877,7 +1762,8 @@ static void call_refresh_callback(void)
 						0, refresh_cb, NULL, NULL);
 }
 
-static void service_changed_signal_cb(DBusMessageIter *iter)
+static void service_changed_signal_cb(DBusMessage *message,
+						DBusMessageIter *iter)
 {
 	DBusMessageIter array, strt;
 	char *obj_path;
@@ -886,8 +1772,7 @@ static void service_changed_signal_cb(DBusMessageIter *iter)
 	if (service_if == NULL)
 		return;
 
-	g_slist_free(service_if->ordered_services);
-	service_if->ordered_services = NULL;
+	g_ptr_array_set_size(service_if->ordered_services, 0);
 
 	dbus_message_iter_recurse(iter, &array);
 
@@ -898,7 +1783,7 @@ static void service_changed_signal_cb(DBusMessageIter *iter)
 		cui_dbus_get_basic(&strt, DBUS_TYPE_OBJECT_PATH, &obj_path);
 
 		dbus_message_iter_next(&strt);
-		update_or_create_service(obj_path, &strt);
+		update_or_create_service(message, obj_path, &strt);
 
 		dbus_message_iter_next(&array);
 		arg_type = dbus_message_iter_get_arg_type(&array);
@@ -928,7 +1813,7 @@ static void service_changed_signal_cb(DBusMessageIter *iter)
 		call_refresh_callback();
 }
 
-static void get_services_cb(DBusMessageIter *iter)
+static void get_services_cb(DBusMessage *message, DBusMessageIter *iter)
 {
 	DBusMessageIter array;
 	DBusMessageIter strt;
@@ -938,12 +1823,15 @@ static void get_services_cb(DBusMessageIter *iter)
 	if (iter == NULL || service_if == NULL)
 		return;
 
-	g_slist_free(service_if->ordered_services);
-	service_if->ordered_services = NULL;
-
 	if (dbus_message_iter_get_arg_type(iter) != DBUS_TYPE_ARRAY)
 		return;
 
+	/*
+	 * ConnMan sends its signals and replies in order, and they are
+	 * handled as they come: this list is newer than any change before.
+	 */
+	g_ptr_array_set_size(service_if->ordered_services, 0);
+
 	dbus_message_iter_recurse(iter, &array);
 
 	arg_type = dbus_message_iter_get_arg_type(&array);
@@ -953,17 +1841,130 @@ static void get_services_cb(DBusMessageIter *iter)
 		cui_dbus_get_basic(&strt, DBUS_TYPE_OBJECT_PATH, &obj_path);
 
 		dbus_message_iter_next(&strt);
-		update_or_create_service(obj_path, &strt);
+		update_or_create_service(message, obj_path, &strt);
 
 		dbus_message_iter_next(&array);
 		arg_type = dbus_message_iter_get_arg_type(&array);
 	}
 
-	if (service_if->refreshed == FALSE) {
-		service_if->refreshed = TRUE;
-		__connman_manager_get_services(get_services_cb);
-	} else
-		call_refresh_callback();
+	service_if->refreshed = TRUE;
+	call_refresh_callback();
+}
+
+/* Longest flattened property name a visitor is given */
+#define VISIT_NAME_MAX 128
+
+struct service_walk {
+	const struct connman_service_visitor *visitor;
+	void *user_data;
+	const char *path;
+	size_t prefix;
+	char name[VISIT_NAME_MAX];
+};
+
+static struct {
+	gboolean pending;
+	struct connman_service_visitor visitor;
+	void *user_data;
+} visit;
+
+static bool walk_property_cb(DBusMessageIter *iter, void *user_data)
+{
+	struct service_walk *walk = user_data;
+	size_t prefix = walk->prefix;
+	struct connman_value value;
+	DBusMessageIter variant;
+	const char *name;
+	size_t length;
+
+	dbus_message_iter_get_basic(iter, &name);
+
+	dbus_message_iter_next(iter);
+	dbus_message_iter_recurse(iter, &variant);
+
+	/* Room is kept for the '.' of a nested dictionary */
+	length = strlen(name);
+	if (prefix + length + 2 > VISIT_NAME_MAX)
+		return FALSE;
+
+	memcpy(walk->name + prefix, name, length + 1);
+
+	if (dbus_message_iter_get_arg_type(&variant) == DBUS_TYPE_ARRAY &&
+			dbus_message_iter_get_element_type(&variant) ==
+							DBUS_TYPE_DICT_ENTRY) {
+		walk->name[prefix + length] = '.';
+		walk->prefix = prefix + length + 1;
+
+		cui_dbus_foreach_dict_entry(&variant, walk_property_cb, walk);
+
+		walk->prefix = prefix;
+
+		return FALSE;
+	}
+
+	if (__connman_get_value(&variant, &value) == TRUE)
+		walk->visitor->property(walk->path, walk->name,
+						&value, walk->user_data);
+
+	return FALSE;
+}
+
+static int walk_services(DBusMessageIter *iter,
+				const struct connman_service_visitor *visitor,
+				void *user_data)
+{
+	struct service_walk walk;
+	DBusMessageIter array;
+	DBusMessageIter strt;
+
+	if (dbus_message_iter_get_arg_type(iter) != DBUS_TYPE_ARRAY)
+		return -EINVAL;
+
+	walk.visitor = visitor;
+	walk.user_data = user_data;
+	walk.prefix = 0;
+
+	dbus_message_iter_recurse(iter, &array);
+
+	while (dbus_message_iter_get_arg_type(&array) == DBUS_TYPE_STRUCT) {
+		dbus_message_iter_recurse(&array, &strt);
+		dbus_message_iter_next(&array);
+
+		if (cui_dbus_get_basic(&strt, DBUS_TYPE_OBJECT_PATH,
+							&walk.path) != 0)
+			return -EINVAL;
+
+		if (visitor->service != NULL &&
+			visitor->service(walk.path, user_data) == FALSE)
+			continue;
+
+		if (visitor->property == NULL)
+			continue;
+
+		dbus_message_iter_next(&strt);
+		cui_dbus_foreach_dict_entry(&strt, walk_property_cb, &walk);
+	}
+
+	return 0;
+}
+
+static void visit_services_cb(DBusMessage *message, DBusMessageIter *iter)
+{
+	struct connman_service_visitor visitor;
+	void *user_data;
+	int err;
+
+	if (visit.pending == FALSE)
+		return;
+
+	visitor = visit.visitor;
+	user_data = visit.user_data;
+	memset(&visit, 0, sizeof(visit));
+
+	err = walk_services(iter, &visitor, user_data);
+
+	if (visitor.done != NULL)
+		visitor.done(err, user_data);
 }
 
 static void scan_services_cb(void *user_data)
@@ -975,7 +1976,17 @@ static void scan_services_cb(void *user_data)
 		service_if->scan_services_cb(service_if->refresh_user_data);
 }
 
-static int call_empty_method(const char *path, const char *method)
+static DBusMessage *new_method_call(struct connman_service *service,
+						enum service_method method)
+{
+	return __connman_message_new_method_call(service->path,
+					CONNMAN_SERVICE_INTERFACE,
+					Service_methods[method],
+					method == SERVICE_METHOD_SET_PROPERTY ?
+								"sv" : NULL);
+}
+
+static int call_empty_method(const char *path, enum service_method method)
 {
 	struct connman_service *service;
 	DBusMessage *message;
@@ -984,10 +1995,7 @@ static int call_empty_method(const char *path, const char *method)
 	if (service == NULL)
 		return -EINVAL;
 
-	message = dbus_message_new_method_call(CONNMAN_DBUS_NAME,
-						service->path,
-						CONNMAN_SERVICE_INTERFACE,
-						method);
+	message = new_method_call(service, method);
 	if (message == NULL)
 		return -ENOMEM;
 
@@ -996,16 +2004,113 @@ static int call_empty_method(const char *path, const char *method)
 		return -EINVAL;
 	}
 
+	/* Without a reply to end it, only its states can */
+	if (method == SERVICE_METHOD_CONNECT)
+		start_connect_timeline(service);
+
 	return 0;
 }
 
+/* Failed replies end the attempt, successful ones leave it to State */
+static void connect_reply_hook(const struct connman_reply *reply,
+							void *user_data)
+{
+	struct connman_connect_timeline *attempt;
+	struct connman_service *service;
+	struct connect_stats *stats;
+
+	service = get_service(reply->path);
+	if (service == NULL)
+		return;
+
+	attempt = last_attempt(service);
+	if (attempt == NULL || attempt->finished == TRUE)
+		return;
+
+	/* InProgress: another connect call joined the attempt being made */
+	if (reply->error == 0 || reply->error == -EINPROGRESS)
+		return;
+
+	attempt->finished = TRUE;
+
+	if (reply->error == -EISCONN)
+		return;
+
+	attempt->step[CONNMAN_CONNECT_FAILURE] =
+			MAX(g_get_monotonic_time() - attempt->started, 1);
+	attempt->error = connman_intern(reply->error_name);
+
+	stats = get_connect_stats(service->type_id);
+	if (stats != NULL)
+		stats->failures++;
+}
+
+static guint call_method_async(const char *path, enum service_method method,
+				int timeout, connman_reply_cb_f callback,
+				void *user_data)
+{
+	struct connman_service *service;
+	DBusMessage *message;
+	guint id;
+
+	service = get_service(path);
+	if (service == NULL)
+		return 0;
+
+	message = new_method_call(service, method);
+	if (message == NULL)
+		return 0;
+
+	id = __connman_request_send(service_if->dbus_cnx, message,
+					timeout, callback, user_data);
+	dbus_message_unref(message);
+
+	if (id != 0 && method == SERVICE_METHOD_CONNECT) {
+		start_connect_timeline(service);
+		__connman_request_set_hook(id, connect_reply_hook);
+	}
+
+	return id;
+}
+
+static int send_property_message(struct connman_service *service,
+				enum connman_service_property property,
+				DBusMessage *message);
+
+static void property_applied(struct connman_service *service, int index,
+					DBusMessage *message, int error)
+{
+	struct connman_value value, *applied = NULL;
+	DBusMessageIter iter, variant;
+
+	if (service->property_applied_cb == NULL)
+		return;
+
+	/* Past the name of the property, to its value */
+	if (dbus_message_iter_init(message, &iter) == TRUE &&
+				dbus_message_iter_next(&iter) == TRUE &&
+				dbus_message_iter_get_arg_type(&iter) ==
+							DBUS_TYPE_VARIANT) {
+		dbus_message_iter_recurse(&iter, &variant);
+
+		if (__connman_get_value(&variant, &value) == TRUE)
+			applied = &value;
+	}
+
+	service->property_applied_cb(service->path, PROPERTY(index),
+				applied, error,
+				service->property_applied_user_data);
+}
+
 static void set_property_cb(DBusPendingCall *pending, void *user_data)
 {
 	struct property_setting *set = user_data;
+	struct service_activity *activity;
 	struct connman_service *service;
 	struct property_change *property;
-	DBusMessage *reply;
+	DBusMessage *reply = NULL, *message, *queued;
 	DBusError error;
+	int index, err;
 
 	if (dbus_pending_call_get_completed(pending) == FALSE)
 		return;
@@ -1014,48 +2119,68 @@ static void set_property_cb(DBusPendingCall *pending, void *user_data)
 		return;
 
 	service = set->data;
+	index = set->index;
+	activity = service->activity;
 
-	service->call_modify[set->index] = NULL;
+	dbus_pending_call_unref(activity->call_modify[index]);
+	activity->call_modify[index] = NULL;
 
-	if (service->property_set_error_cb == NULL)
-		return;
+	message = activity->sent_modify[index];
+	activity->sent_modify[index] = NULL;
 
-	property = g_try_malloc0(sizeof(struct property_change));
-	if (property == NULL)
-		return;
+	/* Only the outcome of the last value set is reported */
+	queued = activity->queued_modify[index];
+	if (queued != NULL) {
+		activity->queued_modify[index] = NULL;
 
-	reply = dbus_pending_call_steal_reply(pending);
-	if (reply == NULL)
-		return;
+		err = send_property_message(service, index, queued);
+		dbus_message_unref(queued);
+
+		if (err == 0)
+			goto done;
+	}
 
 	dbus_error_init(&error);
-	if (dbus_set_error_from_message(&error, reply) == FALSE)
-		goto done;
+	err = 0;
+
+	reply = dbus_pending_call_steal_reply(pending);
+	if (reply == NULL)
+		err = -EIO;
+	else if (dbus_set_error_from_message(&error, reply) == TRUE) {
+		printf("SetProperty Error: %s\n", error.message);
+		err = __connman_error2errno(error.name);
+		dbus_error_free(&error);
+	}
 
-	printf("SetProperty Error: %s\n", error.message);
-	dbus_error_free(&error);
+	property_applied(service, index, message, err);
 
-	if (service->property_set_error_cb == NULL)
+	if (reply == NULL || err == 0 || service->property_set_error_cb == NULL)
 		goto done;
 
 	property = g_try_malloc0(sizeof(struct property_change));
 	if (property == NULL)
 		goto done;
 
+	property->index = index;
 	property->path = service->path;
-	property->name = PROPERTY(set->index);
+	property->name = PROPERTY(index);
 	property->error = -1;
 
-	if (service->to_error[set->index] != 0)
-		g_source_remove(service->to_error[set->index]);
+	if (activity->to_error[index] != 0)
+		g_source_remove(activity->to_error[index]);
 
-	service->to_error[set->index] = g_timeout_add_full(
+	activity->to_error[index] = g_timeout_add_full(
 						G_PRIORITY_DEFAULT,
-						0, property_changed_or_error,
+						0, property_error,
 						property, destroy_property);
 
 done:
-	dbus_message_unref(reply);
+	if (reply != NULL)
+		dbus_message_unref(reply);
+
+	dbus_message_unref(message);
+
+	release_activity(service);
 }
 
 static void append_ipv4_config(DBusMessageIter *dict, void *data)
@@ -1120,35 +2245,80 @@ static void append_proxy_config(DBusMessageIter *dict, void *data)
 	g_strfreev(config_list);
 }
 
-static int set_service_property(struct connman_service *service,
+/*
+ * The known value may be about to be overwritten by a pending call, so it
+ * can't be used to skip setting the same value again.
+ */
+static gboolean is_pending(struct connman_service *service,
+				enum connman_service_property property)
+{
+	if (service->activity == NULL)
+		return FALSE;
+
+	return service->activity->call_modify[property] != NULL;
+}
+
+/*
+ * While a call is pending for that property, message replaces any value
+ * queued after it instead of being sent: the last one is sent once the
+ * pending call completes.
+ */
+static int send_property_message(struct connman_service *service,
 				enum connman_service_property property,
-				int dbus_type, void *data)
+				DBusMessage *message)
 {
-	struct property_setting *set = NULL;
-	const char *property_name;
-	DBusMessage *message;
-	DBusMessageIter arg;
+	struct service_activity *activity = service->activity;
+	struct property_setting *set;
 
-	if (connman == NULL)
-		return -EINVAL;
+	if (activity->call_modify[property] != NULL) {
+		if (activity->queued_modify[property] != NULL)
+			dbus_message_unref(activity->queued_modify[property]);
 
-	if (service->call_modify[property] != NULL)
-		return -EINVAL;
+		activity->queued_modify[property] = dbus_message_ref(message);
 
-	message = dbus_message_new_method_call(CONNMAN_DBUS_NAME,
-						service->path,
-						CONNMAN_SERVICE_INTERFACE,
-						"SetProperty");
-	if (message == NULL)
-		return -ENOMEM;
+		return 0;
+	}
 
 	set = g_try_malloc0(sizeof(struct property_setting));
 	if (set == NULL)
-		goto error;
+		return -ENOMEM;
 
 	set->data = service;
 	set->index = property;
 
+	if (dbus_connection_send_with_reply(service_if->dbus_cnx, message,
+					&activity->call_modify[property],
+					DBUS_TIMEOUT_USE_DEFAULT) == FALSE) {
+		g_free(set);
+		return -EINVAL;
+	}
+
+	if (dbus_pending_call_set_notify(activity->call_modify[property],
+				set_property_cb, set, g_free) == FALSE) {
+		dbus_pending_call_cancel(activity->call_modify[property]);
+		dbus_pending_call_unref(activity->call_modify[property]);
+		activity->call_modify[property] = NULL;
+		g_free(set);
+		return -EINVAL;
+	}
+
+	activity->sent_modify[property] = dbus_message_ref(message);
+
+	return 0;
+}
+
+static DBusMessage *new_set_property(struct connman_service *service,
+				enum connman_service_property property,
+				int dbus_type, void *data)
+{
+	const char *property_name;
+	DBusMessage *message;
+	DBusMessageIter arg;
+
+	message = new_method_call(service, SERVICE_METHOD_SET_PROPERTY);
+	if (message == NULL)
+		return NULL;
+
 	property_name = PROPERTY(property);
 
 	dbus_message_iter_init_append(message, &arg);
@@ -1173,30 +2343,59 @@ static int set_service_property(struct connman_service *service,
 				DBUS_TYPE_STRING, append_string_list, data);
 		break;
 	default:
-		cui_dbus_append_basic(&arg, property_name, dbus_type, data);
+		if (cui_dbus_append_set_property(message, property_name,
+							dbus_type, data) < 0) {
+			dbus_message_unref(message);
+			return NULL;
+		}
 		break;
 	}
 
-	if (dbus_connection_send_with_reply(service_if->dbus_cnx, message,
-					&service->call_modify[property],
-					DBUS_TIMEOUT_USE_DEFAULT) == FALSE)
-		goto error;
+	return message;
+}
+
+static int set_service_property(struct connman_service *service,
+				enum connman_service_property property,
+				int dbus_type, void *data)
+{
+	DBusMessage *message;
+	int err;
+
+	if (connman == NULL)
+		return -EINVAL;
 
-	if (dbus_pending_call_set_notify(service->call_modify[property],
-					set_property_cb, set, g_free) == FALSE)
-		goto error;
+	if (get_activity(service) == NULL)
+		return -ENOMEM;
 
-	return 0;
+	message = new_set_property(service, property, dbus_type, data);
+	if (message == NULL) {
+		release_activity(service);
+		return -ENOMEM;
+	}
+
+	err = send_property_message(service, property, message);
 
-error:
 	dbus_message_unref(message);
 
-	if (set == NULL)
-		return -ENOMEM;
+	if (err < 0)
+		release_activity(service);
 
-	g_free(set);
+	return err;
+}
+
+void connman_service_set_borrowed_strings(gboolean enable)
+{
+	borrow_strings = enable;
+}
+
+void connman_service_set_cache_mode(gboolean enable)
+{
+	keep_cache = enable;
+}
 
-	return -EINVAL;
+void connman_service_set_lazy_decoding(gboolean enable)
+{
+	lazy_details = enable;
 }
 
 int connman_service_init(void)
@@ -1219,24 +2418,55 @@ int connman_service_init(void)
 		return -ENOMEM;
 	};
 
+	service_if->ordered_services = g_ptr_array_new();
+	service_if->dirty_services = g_ptr_array_new();
+
 	service_if->dbus_cnx = dbus_connection_ref(connman->dbus_cnx);
 
+	service_if->property_changed_wid = g_dbus_add_signal_watch(
+						service_if->dbus_cnx,
+						CONNMAN_DBUS_NAME, NULL,
+						CONNMAN_SERVICE_INTERFACE,
+						"PropertyChanged",
+						property_changed_signal_cb,
+						NULL, NULL);
+
+	if (keep_cache == TRUE) {
+		__connman_manager_register_service_signal(
+						service_changed_signal_cb);
+		__connman_manager_get_services(get_services_cb);
+	}
+
 	return 0;
 }
 
+static void cancel_applies(void);
+
 void connman_service_finalize(void)
 {
 	if (service_if == NULL)
 		return;
 
+	cancel_applies();
+
 	__connman_manager_register_service_signal(NULL);
 
+	if (service_if->property_changed_wid != 0)
+		g_dbus_remove_watch(service_if->dbus_cnx,
+					service_if->property_changed_wid);
+
 	dbus_connection_unref(service_if->dbus_cnx);
 
 	connman_service_deselect();
 
-	g_slist_free(service_if->ordered_services);
+	if (service_if->to_flush != 0)
+		g_source_remove(service_if->to_flush);
+
+	clear_dirty_services();
+	g_ptr_array_set_size(service_if->ordered_services, 0);
 	g_hash_table_destroy(service_if->services);
+	g_ptr_array_free(service_if->ordered_services, TRUE);
+	g_ptr_array_free(service_if->dirty_services, TRUE);
 
 	g_free(service_if);
 
@@ -1246,60 +2476,79 @@ void connman_service_finalize(void)
 int connman_service_refresh_services_list(connman_refresh_cb_f refresh_cb,
 				connman_scan_cb_f scan_cb, void *user_data)
 {
-	GList *techs;
-	GList *list;
-	char *path;
+	const char *path;
 
 	if (service_if == NULL)
 		return -EINVAL;
 
 	service_if->refreshed = FALSE;
 
-	techs = connman_technology_get_technologies();
-	if (techs == NULL)
+	if (__connman_technology_count() == 0)
 		return -EINVAL;
 
-	for (list = techs; list != NULL; list = list->next) {
-		const char *type;
-		path = list->data;
-
-		type = connman_technology_get_type(path);
-
-		if (g_strcmp0(type, "wifi") == 0)
-			break;
-
-		path = NULL;
-	};
-
-	g_list_free(techs);
+	path = connman_technology_find_by_type(CONNMAN_TECH_TYPE_WIFI);
 
 	service_if->refresh_services_cb = refresh_cb;
 	service_if->scan_services_cb = scan_cb;
 	service_if->refresh_user_data = user_data;
 
-	if (path == NULL || connman_technology_is_enabled(path) == FALSE) {
-		__connman_manager_get_services(get_services_cb);
+	/* Render what is known right away, it is refreshed below */
+	if (keep_cache == TRUE && service_if->ordered_services->len > 0)
+		call_refresh_callback();
+
+	/* The reply is followed by the changes ConnMan signals */
+	__connman_manager_register_service_signal(service_changed_signal_cb);
+	__connman_manager_get_services(get_services_cb);
 
+	if (path == NULL || connman_technology_is_enabled(path) == FALSE) {
 		if (service_if->scan_services_cb != NULL)
 			service_if->scan_services_cb(
 						service_if->refresh_user_data);
-	} else {
-		__connman_manager_register_service_signal(
-						service_changed_signal_cb);
+	} else
 		connman_technology_scan(path, scan_services_cb, NULL);
 
-		__connman_manager_get_services(get_services_cb);
-	}
-
 	return 0;
 }
 
 GSList *connman_service_get_services(void)
 {
-	if (service_if == NULL || service_if->ordered_services == NULL)
+	GSList *list = NULL;
+	unsigned int i;
+
+	if (service_if == NULL)
+		return NULL;
+
+	for (i = service_if->ordered_services->len; i > 0; i--)
+		list = g_slist_prepend(list,
+			g_ptr_array_index(service_if->ordered_services, i - 1));
+
+	return list;
+}
+
+const char **connman_service_borrow_services(unsigned int *length)
+{
+	if (length == NULL)
+		return NULL;
+
+	*length = 0;
+
+	if (service_if == NULL || service_if->ordered_services->len == 0)
 		return NULL;
 
-	return g_slist_copy(service_if->ordered_services);
+	*length = service_if->ordered_services->len;
+
+	return (const char **) service_if->ordered_services->pdata;
+}
+
+int connman_service_get_position(const char *path)
+{
+	struct connman_service *service;
+
+	service = get_service(path);
+	if (service == NULL || is_ordered(service) == FALSE)
+		return -EINVAL;
+
+	return service->position;
 }
 
 void connman_service_free_services_list(void)
@@ -1307,14 +2556,73 @@ void connman_service_free_services_list(void)
 	if (service_if == NULL)
 		return;
 
+	if (keep_cache == TRUE) {
+		if (service_if->to_refresh != 0)
+			g_source_remove(service_if->to_refresh);
+
+		service_if->to_refresh = 0;
+		service_if->refresh_services_cb = NULL;
+		service_if->scan_services_cb = NULL;
+		service_if->refresh_user_data = NULL;
+
+		return;
+	}
+
 	__connman_manager_register_service_signal(NULL);
+	__connman_manager_get_services(NULL);
 
-	g_slist_free(service_if->ordered_services);
-	service_if->ordered_services = NULL;
+	clear_dirty_services();
+	g_ptr_array_set_size(service_if->ordered_services, 0);
 
 	g_hash_table_remove_all(service_if->services);
 }
 
+int connman_service_visit_services(const struct connman_service_visitor *visitor,
+							void *user_data)
+{
+	int err;
+
+	memset(&visit, 0, sizeof(visit));
+
+	if (visitor == NULL)
+		return __connman_manager_visit_services(NULL);
+
+	visit.pending = TRUE;
+	visit.visitor = *visitor;
+	visit.user_data = user_data;
+
+	err = __connman_manager_visit_services(visit_services_cb);
+	if (err < 0)
+		memset(&visit, 0, sizeof(visit));
+
+	return err;
+}
+
+int connman_value_join_strings(const struct connman_value *value,
+				char separator, char *buffer, size_t size)
+{
+	DBusMessageIter array;
+
+	if (value == NULL || value->type != CONNMAN_VALUE_STRING_ARRAY ||
+							value->array == NULL)
+		return -EINVAL;
+
+	array = *(const DBusMessageIter *) value->array;
+
+	return cui_dbus_join_string_array(&array, separator, buffer, size);
+}
+
+void connman_service_set_changed_callback(
+			connman_service_changed_cb_f changed_cb,
+			void *user_data)
+{
+	if (service_if == NULL)
+		return;
+
+	service_if->changed_cb = changed_cb;
+	service_if->changed_user_data = user_data;
+}
+
 void connman_service_set_property_changed_callback(const char *path,
 			connman_property_changed_cb_f property_changed_cb,
 			void *user_data)
@@ -1343,6 +2651,20 @@ void connman_service_set_property_error_callback(const char *path,
 	service->property_set_error_user_data = user_data;
 }
 
+void connman_service_set_property_applied_callback(const char *path,
+			connman_property_applied_cb_f property_applied_cb,
+			void *user_data)
+{
+	struct connman_service *service;
+
+	service = get_service(path);
+	if (service == NULL)
+		return;
+
+	service->property_applied_cb = property_applied_cb;
+	service->property_applied_user_data = user_data;
+}
+
 void connman_service_set_removed_callback(
 				connman_path_changed_cb_f removed_cb)
 {
@@ -1350,275 +2672,378 @@ void connman_service_set_removed_callback(
 		service_if->removed_cb = removed_cb;
 }
 
-const char *connman_service_get_name(const char *path)
+connman_service_t *connman_service_ref(const char *path)
 {
 	struct connman_service *service;
 
 	service = get_service(path);
 	if (service == NULL)
-		 return NULL;
+		return NULL;
+
+	service->refcount++;
+
+	return service;
+}
+
+void connman_service_unref(connman_service_t *service)
+{
+	if (service == NULL)
+		return;
+
+	service_unref(service);
+}
+
+const char *connman_service_handle_get_path(const connman_service_t *service)
+{
+	if (service == NULL)
+		return NULL;
+
+	return service->path;
+}
+
+const char *connman_service_handle_get_name(const connman_service_t *service)
+{
+	if (service == NULL)
+		return NULL;
 
 	return service->name;
 }
 
-const char *connman_service_get_type(const char *path)
+const char *connman_service_get_name(const char *path)
 {
-	struct connman_service *service;
+	return connman_service_handle_get_name(get_service(path));
+}
 
-	service = get_service(path);
+const char *connman_service_handle_get_type(const connman_service_t *service)
+{
 	if (service == NULL)
-		 return NULL;
+		return NULL;
 
 	return service->type;
 }
 
-enum connman_state connman_service_get_state(const char *path)
+const char *connman_service_get_type(const char *path)
 {
-	struct connman_service *service;
+	return connman_service_handle_get_type(get_service(path));
+}
 
-	service = get_service(path);
+enum connman_tech_type connman_service_handle_get_type_id(
+					const connman_service_t *service)
+{
+	if (service == NULL)
+		return CONNMAN_TECH_TYPE_UNKNOWN;
+
+	return service->type_id;
+}
+
+enum connman_tech_type connman_service_get_type_id(const char *path)
+{
+	return connman_service_handle_get_type_id(get_service(path));
+}
+
+enum connman_state connman_service_handle_get_state(
+					const connman_service_t *service)
+{
 	if (service == NULL)
-		 return CONNMAN_STATE_OFFLINE;
+		return CONNMAN_STATE_OFFLINE;
 
 	return service->state;
 }
 
+enum connman_state connman_service_get_state(const char *path)
+{
+	return connman_service_handle_get_state(get_service(path));
+}
+
+const char *connman_service_handle_get_error(const connman_service_t *service)
+{
+	if (service == NULL)
+		return NULL;
+
+	return get_details(service)->error;
+}
+
 const char *connman_service_get_error(const char *path)
 {
-	struct connman_service *service;
+	return connman_service_handle_get_error(get_service(path));
+}
 
-	service = get_service(path);
+const char *connman_service_handle_get_security(
+					const connman_service_t *service)
+{
 	if (service == NULL)
-		 return NULL;
+		return NULL;
 
-	return service->error;
+	return service->security;
 }
 
 const char *connman_service_get_security(const char *path)
 {
-	struct connman_service *service;
+	return connman_service_handle_get_security(get_service(path));
+}
 
-	service = get_service(path);
+uint8_t connman_service_handle_get_strength(const connman_service_t *service)
+{
 	if (service == NULL)
-		 return NULL;
+		return 0;
 
-	return service->security;
+	return service->strength;
 }
 
 uint8_t connman_service_get_strength(const char *path)
 {
-	struct connman_service *service;
+	return connman_service_handle_get_strength(get_service(path));
+}
 
-	service = get_service(path);
+gboolean connman_service_handle_is_favorite(const connman_service_t *service)
+{
 	if (service == NULL)
-		 return 0;
+		return FALSE;
 
-	return service->strength;
+	return service->favorite;
 }
 
 gboolean connman_service_is_favorite(const char *path)
 {
-	struct connman_service *service;
+	return connman_service_handle_is_favorite(get_service(path));
+}
 
-	service = get_service(path);
+gboolean connman_service_handle_is_immutable(const connman_service_t *service)
+{
 	if (service == NULL)
-		 return FALSE;
+		return FALSE;
 
-	return service->favorite;
+	return service->immutable;
 }
 
 gboolean connman_service_is_immutable(const char *path)
 {
-	struct connman_service *service;
+	return connman_service_handle_is_immutable(get_service(path));
+}
 
-	service = get_service(path);
+gboolean connman_service_handle_is_autoconnect(const connman_service_t *service)
+{
 	if (service == NULL)
-		 return FALSE;
+		return FALSE;
 
-	return service->immutable;
+	return service->autoconnect;
 }
 
 gboolean connman_service_is_autoconnect(const char *path)
 {
-	struct connman_service *service;
+	return connman_service_handle_is_autoconnect(get_service(path));
+}
 
-	service = get_service(path);
+gboolean connman_service_handle_is_roaming(const connman_service_t *service)
+{
 	if (service == NULL)
-		 return FALSE;
+		return FALSE;
 
-	return service->autoconnect;
+	return service->roaming;
 }
 
 gboolean connman_service_is_roaming(const char *path)
 {
-	struct connman_service *service;
+	return connman_service_handle_is_roaming(get_service(path));
+}
 
-	service = get_service(path);
+const char *connman_service_handle_get_nameservers(
+					const connman_service_t *service)
+{
 	if (service == NULL)
-		 return FALSE;
+		return NULL;
 
-	return service->roaming;
+	return get_details(service)->nameservers;
 }
 
 const char *connman_service_get_nameservers(const char *path)
 {
-	struct connman_service *service;
+	return connman_service_handle_get_nameservers(get_service(path));
+}
 
-	service = get_service(path);
+const char *connman_service_handle_get_nameservers_config(
+					const connman_service_t *service)
+{
 	if (service == NULL)
-		 return NULL;
+		return NULL;
 
-	return service->nameservers;
+	return get_details(service)->nameservers_conf;
 }
 
 const char *connman_service_get_nameservers_config(const char *path)
 {
-	struct connman_service *service;
+	return connman_service_handle_get_nameservers_config(get_service(path));
+}
 
-	service = get_service(path);
+const char *connman_service_handle_get_domains(const connman_service_t *service)
+{
 	if (service == NULL)
-		 return NULL;
+		return NULL;
 
-	return service->nameservers_conf;
+	return get_details(service)->domains;
 }
 
 const char *connman_service_get_domains(const char *path)
 {
-	struct connman_service *service;
+	return connman_service_handle_get_domains(get_service(path));
+}
 
-	service = get_service(path);
+const char *connman_service_handle_get_domains_config(
+					const connman_service_t *service)
+{
 	if (service == NULL)
-		 return NULL;
+		return NULL;
 
-	return service->domains;
+	return get_details(service)->domains_conf;
 }
 
 const char *connman_service_get_domains_config(const char *path)
 {
-	struct connman_service *service;
+	return connman_service_handle_get_domains_config(get_service(path));
+}
 
-	service = get_service(path);
+const char *connman_service_handle_get_timeservers(
+					const connman_service_t *service)
+{
 	if (service == NULL)
-		 return NULL;
+		return NULL;
 
-	return service->domains_conf;
+	return get_details(service)->timeservers;
 }
 
 const char *connman_service_get_timeservers(const char *path)
 {
-	struct connman_service *service;
+	return connman_service_handle_get_timeservers(get_service(path));
+}
 
-	service = get_service(path);
+const char *connman_service_handle_get_timeservers_config(
+					const connman_service_t *service)
+{
 	if (service == NULL)
-		 return NULL;
+		return NULL;
 
-	return service->timeservers;
+	return get_details(service)->timeservers_conf;
 }
 
 const char *connman_service_get_timeservers_config(const char *path)
 {
-	struct connman_service *service;
+	return connman_service_handle_get_timeservers_config(get_service(path));
+}
 
-	service = get_service(path);
+const struct connman_ipv4 *connman_service_handle_get_ipv4(
+					const connman_service_t *service)
+{
 	if (service == NULL)
-		 return NULL;
+		return NULL;
 
-	return service->timeservers_conf;
+	return get_details(service)->ipv4;
 }
 
 const struct connman_ipv4 *connman_service_get_ipv4(const char *path)
 {
-	struct connman_service *service;
+	return connman_service_handle_get_ipv4(get_service(path));
+}
 
-	service = get_service(path);
+const struct connman_ipv4 *connman_service_handle_get_ipv4_config(
+					const connman_service_t *service)
+{
 	if (service == NULL)
-		 return NULL;
+		return NULL;
 
-	return service->ipv4;
+	return get_details(service)->ipv4_conf;
 }
 
 const struct connman_ipv4 *connman_service_get_ipv4_config(const char *path)
 {
-	struct connman_service *service;
+	return connman_service_handle_get_ipv4_config(get_service(path));
+}
 
-	service = get_service(path);
+const struct connman_ipv6 *connman_service_handle_get_ipv6(
+					const connman_service_t *service)
+{
 	if (service == NULL)
-		 return NULL;
+		return NULL;
 
-	return service->ipv4_conf;
+	return get_details(service)->ipv6;
 }
 
 const struct connman_ipv6 *connman_service_get_ipv6(const char *path)
 {
-	struct connman_service *service;
+	return connman_service_handle_get_ipv6(get_service(path));
+}
 
-	service = get_service(path);
+const struct connman_ipv6 *connman_service_handle_get_ipv6_config(
+					const connman_service_t *service)
+{
 	if (service == NULL)
-		 return NULL;
+		return NULL;
 
-	return service->ipv6;
+	return get_details(service)->ipv6_conf;
 }
 
 const struct connman_ipv6 *connman_service_get_ipv6_config(const char *path)
 {
-	struct connman_service *service;
+	return connman_service_handle_get_ipv6_config(get_service(path));
+}
 
-	service = get_service(path);
+const struct connman_proxy *connman_service_handle_get_proxy(
+					const connman_service_t *service)
+{
 	if (service == NULL)
-		 return NULL;
+		return NULL;
 
-	return service->ipv6_conf;
+	return get_details(service)->proxy;
 }
 
 const struct connman_proxy *connman_service_get_proxy(const char *path)
 {
-	struct connman_service *service;
+	return connman_service_handle_get_proxy(get_service(path));
+}
 
-	service = get_service(path);
+const struct connman_proxy *connman_service_handle_get_proxy_config(
+					const connman_service_t *service)
+{
 	if (service == NULL)
-		 return NULL;
+		return NULL;
 
-	return service->proxy;
+	return get_details(service)->proxy_conf;
 }
 
 const struct connman_proxy *connman_service_get_proxy_config(const char *path)
 {
-	struct connman_service *service;
+	return connman_service_handle_get_proxy_config(get_service(path));
+}
 
-	service = get_service(path);
+const struct connman_provider *connman_service_handle_get_provider(
+					const connman_service_t *service)
+{
 	if (service == NULL)
-		 return NULL;
+		return NULL;
 
-	return service->proxy_conf;
+	return get_details(service)->provider;
 }
 
 const struct connman_provider *connman_service_get_provider(const char *path)
 {
-	struct connman_service *service;
-
-	service = get_service(path);
-	if (service == NULL)
-		 return NULL;
-
-	return service->provider;
+	return connman_service_handle_get_provider(get_service(path));
 }
 
-const struct connman_ethernet *connman_service_get_ethernet(const char *path)
+const struct connman_ethernet *connman_service_handle_get_ethernet(
+					const connman_service_t *service)
 {
-	struct connman_service *service;
-
-	service = get_service(path);
 	if (service == NULL)
 		return NULL;
 
-	return service->ethernet;
+	return get_details(service)->ethernet;
 }
 
-gboolean connman_service_is_connected(const char *path)
+const struct connman_ethernet *connman_service_get_ethernet(const char *path)
 {
-	struct connman_service *service;
+	return connman_service_handle_get_ethernet(get_service(path));
+}
 
-	service = get_service(path);
+gboolean connman_service_handle_is_connected(const connman_service_t *service)
+{
 	if (service == NULL)
 		return FALSE;
 
@@ -1629,6 +3054,107 @@ gboolean connman_service_is_connected(const char *path)
 	return FALSE;
 }
 
+gboolean connman_service_is_connected(const char *path)
+{
+	return connman_service_handle_is_connected(get_service(path));
+}
+
+#define SNAPSHOT(field, value) do {				\
+	if ((fields & CONNMAN_SERVICE_MASK(field)) != 0) {		\
+		value;							\
+		if (service->field_generation[field] > generation)	\
+			generation = service->field_generation[field];	\
+	}								\
+} while (0)
+
+uint32_t connman_service_handle_get_snapshot(const connman_service_t *service,
+			struct connman_service_info *info, uint32_t fields)
+{
+	const struct service_details *details;
+	uint32_t generation = 0;
+
+	if (info == NULL)
+		return 0;
+
+	memset(info, 0, sizeof(struct connman_service_info));
+
+	if (service == NULL)
+		return 0;
+
+	details = get_details(service);
+	info->path = service->path;
+
+	SNAPSHOT(SERVICE_NAME, info->name = service->name);
+	SNAPSHOT(SERVICE_TYPE, info->type = service->type;
+					info->type_id = service->type_id);
+	SNAPSHOT(SERVICE_SECURITY, info->security = service->security);
+	SNAPSHOT(SERVICE_IMMUTABLE, info->immutable = service->immutable);
+	SNAPSHOT(SERVICE_STATE, info->state = service->state);
+	SNAPSHOT(SERVICE_ERROR, info->error = details->error);
+	SNAPSHOT(SERVICE_STRENGTH, info->strength = service->strength);
+	SNAPSHOT(SERVICE_FAVORITE, info->favorite = service->favorite);
+	SNAPSHOT(SERVICE_AUTOCONNECT,
+			info->autoconnect = service->autoconnect);
+	SNAPSHOT(SERVICE_ROAMING, info->roaming = service->roaming);
+	SNAPSHOT(SERVICE_NAMESERVERS,
+			info->nameservers = details->nameservers);
+	SNAPSHOT(SERVICE_NAMESERVERS_CONFIGURATION,
+			info->nameservers_conf = details->nameservers_conf);
+	SNAPSHOT(SERVICE_TIMESERVERS,
+			info->timeservers = details->timeservers);
+	SNAPSHOT(SERVICE_TIMESERVERS_CONFIGURATION,
+			info->timeservers_conf = details->timeservers_conf);
+	SNAPSHOT(SERVICE_DOMAINS, info->domains = details->domains);
+	SNAPSHOT(SERVICE_DOMAINS_CONFIGURATION,
+			info->domains_conf = details->domains_conf);
+	SNAPSHOT(SERVICE_IPv4, info->ipv4 = details->ipv4);
+	SNAPSHOT(SERVICE_IPv4_CONFIGURATION,
+			info->ipv4_conf = details->ipv4_conf);
+	SNAPSHOT(SERVICE_IPv6, info->ipv6 = details->ipv6);
+	SNAPSHOT(SERVICE_IPv6_CONFIGURATION,
+			info->ipv6_conf = details->ipv6_conf);
+	SNAPSHOT(SERVICE_PROXY, info->proxy = details->proxy);
+	SNAPSHOT(SERVICE_PROXY_CONFIGURATION,
+			info->proxy_conf = details->proxy_conf);
+	SNAPSHOT(SERVICE_PROVIDER, info->provider = details->provider);
+	SNAPSHOT(SERVICE_ETHERNET, info->ethernet = details->ethernet);
+
+	return generation;
+}
+
+uint32_t connman_service_get_snapshot(const char *path,
+			struct connman_service_info *info, uint32_t fields)
+{
+	return connman_service_handle_get_snapshot(get_service(path),
+							info, fields);
+}
+
+gboolean connman_service_handle_changed_since(const connman_service_t *service,
+				uint32_t generation, uint32_t *changed)
+{
+	uint32_t mask = 0;
+	int i;
+
+	if (service != NULL && service->generation > generation) {
+		for (i = 0; i < SERVICE_FIELD_MAX; i++) {
+			if (service->field_generation[i] > generation)
+				mask |= CONNMAN_SERVICE_MASK(i);
+		}
+	}
+
+	if (changed != NULL)
+		*changed = mask;
+
+	return mask != 0;
+}
+
+gboolean connman_service_changed_since(const char *path,
+				uint32_t generation, uint32_t *changed)
+{
+	return connman_service_handle_changed_since(get_service(path),
+							generation, changed);
+}
+
 int connman_service_select(const char *path)
 {
 	struct connman_service *service;
@@ -1637,6 +3163,9 @@ int connman_service_select(const char *path)
 	if (service == NULL)
 		return -EINVAL;
 
+	service->refcount++;
+
+	connman_service_deselect();
 	service_if->selected_service = service;
 
 	return 0;
@@ -1644,7 +3173,7 @@ int connman_service_select(const char *path)
 
 void connman_service_deselect(void)
 {
-	struct connman_service *service, *service_in_ht;
+	struct connman_service *service;
 
 	if (service_if == NULL || service_if->selected_service == NULL)
 		return;
@@ -1652,24 +3181,43 @@ void connman_service_deselect(void)
 	service = service_if->selected_service;
 	service_if->selected_service = NULL;
 
-	service_in_ht = get_service(service->path);
-	if (service_in_ht == NULL)
-		service_free(service);
+	service_unref(service);
 }
 
 int connman_service_connect(const char *path)
 {
-	return call_empty_method(path, "Connect");
+	return call_empty_method(path, SERVICE_METHOD_CONNECT);
 }
 
 int connman_service_disconnect(const char *path)
 {
-	return call_empty_method(path, "Disconnect");
+	return call_empty_method(path, SERVICE_METHOD_DISCONNECT);
 }
 
 int connman_service_remove(const char *path)
 {
-	return call_empty_method(path, "Remove");
+	return call_empty_method(path, SERVICE_METHOD_REMOVE);
+}
+
+guint connman_service_connect_async(const char *path, int timeout,
+			connman_reply_cb_f callback, void *user_data)
+{
+	return call_method_async(path, SERVICE_METHOD_CONNECT,
+					timeout, callback, user_data);
+}
+
+guint connman_service_disconnect_async(const char *path, int timeout,
+			connman_reply_cb_f callback, void *user_data)
+{
+	return call_method_async(path, SERVICE_METHOD_DISCONNECT,
+					timeout, callback, user_data);
+}
+
+guint connman_service_remove_async(const char *path, int timeout,
+			connman_reply_cb_f callback, void *user_data)
+{
+	return call_method_async(path, SERVICE_METHOD_REMOVE,
+					timeout, callback, user_data);
 }
 
 int connman_service_set_autoconnectable(const char *path, gboolean enable)
@@ -1696,8 +3244,9 @@ int connman_service_set_ipv4_config(const char *path,
 	if (service == NULL)
 		return -EINVAL;
 
-	if (service->ipv4_conf != NULL) {
-		struct connman_ipv4 *orig = service->ipv4_conf;
+	if (is_pending(service, SERVICE_IPv4_CONFIGURATION) == FALSE &&
+				get_details(service)->ipv4_conf != NULL) {
+		struct connman_ipv4 *orig = get_details(service)->ipv4_conf;
 
 		if (g_strcmp0(orig->method, ipv4_config->method) != 0 ||
 				g_strcmp0(orig->address,
@@ -1728,8 +3277,9 @@ int connman_service_set_ipv6_config(const char *path,
 	if (service == NULL)
 		return -EINVAL;
 
-	if (service->ipv6_conf != NULL) {
-		struct connman_ipv6 *orig = service->ipv6_conf;
+	if (is_pending(service, SERVICE_IPv6_CONFIGURATION) == FALSE &&
+				get_details(service)->ipv6_conf != NULL) {
+		struct connman_ipv6 *orig = get_details(service)->ipv6_conf;
 
 		if (g_strcmp0(orig->method, ipv6_config->method) != 0 ||
 				g_strcmp0(orig->address,
@@ -1761,8 +3311,9 @@ int connman_service_set_proxy_config(const char *path,
 	if (service == NULL)
 		return -EINVAL;
 
-	if (service->proxy_conf != NULL) {
-		struct connman_proxy *orig = service->proxy_conf;
+	if (is_pending(service, SERVICE_PROXY_CONFIGURATION) == FALSE &&
+				get_details(service)->proxy_conf != NULL) {
+		struct connman_proxy *orig = get_details(service)->proxy_conf;
 
 		if (g_strcmp0(orig->method, proxy_config->method) != 0 ||
 				g_strcmp0(orig->url,
@@ -1792,7 +3343,9 @@ int connman_service_set_nameservers_config(const char *path,
 	if (service == NULL)
 		return -EINVAL;
 
-	if (g_strcmp0(service->nameservers_conf, nameservers_config) == 0)
+	if (is_pending(service, SERVICE_NAMESERVERS_CONFIGURATION) == FALSE &&
+			g_strcmp0(get_details(service)->nameservers_conf,
+						nameservers_config) == 0)
 		return 0;
 
 	config_list = g_strsplit(nameservers_config, ";", 0);
@@ -1818,7 +3371,9 @@ int connman_service_set_domains_config(const char *path,
 	if (service == NULL)
 		return -EINVAL;
 
-	if (g_strcmp0(service->domains_conf, domains_config) == 0)
+	if (is_pending(service, SERVICE_DOMAINS_CONFIGURATION) == FALSE &&
+			g_strcmp0(get_details(service)->domains_conf,
+						domains_config) == 0)
 		return 0;
 
 	config_list = g_strsplit(domains_config, ";", 0);
@@ -1844,7 +3399,9 @@ int connman_service_set_timeservers_config(const char *path,
 	if (service == NULL)
 		return -EINVAL;
 
-	if (g_strcmp0(service->timeservers_conf, timeservers_config) == 0)
+	if (is_pending(service, SERVICE_TIMESERVERS_CONFIGURATION) == FALSE &&
+			g_strcmp0(get_details(service)->timeservers_conf,
+						timeservers_config) == 0)
 		return 0;
 
 	config_list = g_strsplit(timeservers_config, ";", 0);
@@ -1858,3 +3415,354 @@ int connman_service_set_timeservers_config(const char *path,
 
 	return ret;
 }
+
+static void apply_done(struct service_apply *apply)
+{
+	if (apply->done_cb != NULL)
+		apply->done_cb(apply->service->path, apply->applied,
+				apply->failed, apply->errors, apply->user_data);
+
+	service_unref(apply->service);
+	g_free(apply);
+}
+
+static void apply_reply_cb(DBusPendingCall *pending, void *user_data)
+{
+	struct property_setting *set = user_data;
+	struct service_apply *apply = set->data;
+	int index = set->index;
+	DBusMessage *reply;
+	DBusError error;
+
+	if (dbus_pending_call_get_completed(pending) == FALSE)
+		return;
+
+	dbus_error_init(&error);
+
+	reply = dbus_pending_call_steal_reply(pending);
+	if (reply == NULL)
+		apply->errors[index] = -EIO;
+	else if (dbus_set_error_from_message(&error, reply) == TRUE) {
+		apply->errors[index] = __connman_error2errno(error.name);
+		dbus_error_free(&error);
+	}
+
+	if (apply->errors[index] != 0)
+		apply->failed |= CONNMAN_SERVICE_MASK(index);
+
+	if (reply != NULL)
+		dbus_message_unref(reply);
+
+	dbus_pending_call_unref(apply->calls[index]);
+	apply->calls[index] = NULL;
+
+	apply->pending &= ~CONNMAN_SERVICE_MASK(index);
+	if (apply->pending != 0)
+		return;
+
+	service_if->applies = g_slist_remove(service_if->applies, apply);
+
+	apply_done(apply);
+}
+
+static void cancel_applies(void)
+{
+	struct service_apply *apply;
+	GSList *list;
+	int i;
+
+	list = service_if->applies;
+	service_if->applies = NULL;
+
+	for (; list != NULL; list = g_slist_delete_link(list, list)) {
+		apply = list->data;
+
+		for (i = 0; i < SERVICE_MAX; i++) {
+			if (apply->calls[i] == NULL)
+				continue;
+
+			dbus_pending_call_cancel(apply->calls[i]);
+			dbus_pending_call_unref(apply->calls[i]);
+			apply->calls[i] = NULL;
+
+			apply->errors[i] = -ECANCELED;
+		}
+
+		apply->failed |= apply->pending;
+		apply->pending = 0;
+
+		apply_done(apply);
+	}
+}
+
+static const void *get_config_value(const struct connman_service_config *config,
+				enum connman_service_property property)
+{
+	switch (property) {
+	case SERVICE_IPv4_CONFIGURATION:
+		return config->ipv4;
+	case SERVICE_IPv6_CONFIGURATION:
+		return config->ipv6;
+	case SERVICE_PROXY_CONFIGURATION:
+		return config->proxy;
+	case SERVICE_NAMESERVERS_CONFIGURATION:
+		return config->nameservers;
+	case SERVICE_DOMAINS_CONFIGURATION:
+		return config->domains;
+	case SERVICE_TIMESERVERS_CONFIGURATION:
+		return config->timeservers;
+	default:
+		break;
+	}
+
+	return NULL;
+}
+
+static DBusMessage *new_config_property(struct connman_service *service,
+				enum connman_service_property property,
+				const struct connman_service_config *config)
+{
+	const void *value = get_config_value(config, property);
+	DBusMessage *message;
+	char **config_list;
+
+	switch (property) {
+	case SERVICE_IPv4_CONFIGURATION:
+	case SERVICE_IPv6_CONFIGURATION:
+	case SERVICE_PROXY_CONFIGURATION:
+		return new_set_property(service, property, 0, (void *) value);
+	default:
+		break;
+	}
+
+	config_list = g_strsplit(value, ";", 0);
+	if (config_list == NULL)
+		return NULL;
+
+	message = new_set_property(service, property, DBUS_TYPE_STRING,
+							(void *) config_list);
+	g_strfreev(config_list);
+
+	return message;
+}
+
+/*
+ * Newer than any value set by the single setters: the one queued is dropped
+ * and the pending call is forgotten, its reply being about a value about to
+ * be overwritten, and reported as cancelled. ConnMan still gets the calls
+ * in the order they were sent.
+ */
+static void cancel_pending_property(struct connman_service *service,
+				enum connman_service_property property)
+{
+	struct service_activity *activity = service->activity;
+	DBusMessage *last;
+
+	if (activity == NULL || activity->call_modify[property] == NULL)
+		return;
+
+	dbus_pending_call_cancel(activity->call_modify[property]);
+	dbus_pending_call_unref(activity->call_modify[property]);
+	activity->call_modify[property] = NULL;
+
+	/* The last value set is reported, as it would have been */
+	last = activity->queued_modify[property];
+	if (last == NULL)
+		last = activity->sent_modify[property];
+
+	property_applied(service, property, last, -ECANCELED);
+
+	if (activity->queued_modify[property] != NULL) {
+		dbus_message_unref(activity->queued_modify[property]);
+		activity->queued_modify[property] = NULL;
+	}
+
+	dbus_message_unref(activity->sent_modify[property]);
+	activity->sent_modify[property] = NULL;
+
+	release_activity(service);
+}
+
+static int send_config_property(struct service_apply *apply,
+				enum connman_service_property property,
+				const struct connman_service_config *config)
+{
+	struct connman_service *service = apply->service;
+	struct property_setting *set;
+	DBusMessage *message;
+	int err = -EINVAL;
+
+	message = new_config_property(service, property, config);
+	if (message == NULL)
+		return -ENOMEM;
+
+	set = g_try_malloc0(sizeof(struct property_setting));
+	if (set == NULL) {
+		err = -ENOMEM;
+		goto error;
+	}
+
+	set->data = apply;
+	set->index = property;
+
+	if (dbus_connection_send_with_reply(service_if->dbus_cnx, message,
+					&apply->calls[property],
+					DBUS_TIMEOUT_USE_DEFAULT) == FALSE)
+		goto error;
+
+	if (dbus_pending_call_set_notify(apply->calls[property],
+				apply_reply_cb, set, g_free) == FALSE) {
+		dbus_pending_call_cancel(apply->calls[property]);
+		dbus_pending_call_unref(apply->calls[property]);
+		apply->calls[property] = NULL;
+		goto error;
+	}
+
+	dbus_message_unref(message);
+
+	cancel_pending_property(service, property);
+
+	return 0;
+
+error:
+	g_free(set);
+	dbus_message_unref(message);
+
+	return err;
+}
+
+int connman_service_apply(const char *path,
+			const struct connman_service_config *config,
+			uint32_t mask, connman_service_apply_cb_f done_cb,
+			void *user_data)
+{
+	static const enum connman_service_property config_fields[] = {
+		SERVICE_IPv4_CONFIGURATION,
+		SERVICE_IPv6_CONFIGURATION,
+		SERVICE_PROXY_CONFIGURATION,
+		SERVICE_NAMESERVERS_CONFIGURATION,
+		SERVICE_DOMAINS_CONFIGURATION,
+		SERVICE_TIMESERVERS_CONFIGURATION,
+	};
+	struct connman_service *service;
+	struct service_apply *apply;
+	uint32_t config_mask = 0;
+	unsigned int i;
+	int err = -EINVAL;
+
+	if (connman == NULL || config == NULL)
+		return -EINVAL;
+
+	for (i = 0; i < G_N_ELEMENTS(config_fields); i++) {
+		if ((mask & CONNMAN_SERVICE_MASK(config_fields[i])) == 0)
+			continue;
+
+		if (get_config_value(config, config_fields[i]) == NULL)
+			return -EINVAL;
+
+		config_mask |= CONNMAN_SERVICE_MASK(config_fields[i]);
+	}
+
+	if (mask == 0 || mask != config_mask)
+		return -EINVAL;
+
+	service = get_service(path);
+	if (service == NULL)
+		return -EINVAL;
+
+	apply = g_try_malloc0(sizeof(struct service_apply));
+	if (apply == NULL)
+		return -ENOMEM;
+
+	apply->service = service;
+	apply->done_cb = done_cb;
+	apply->user_data = user_data;
+
+	/* All the calls are sent before any reply is waited for */
+	for (i = 0; i < G_N_ELEMENTS(config_fields); i++) {
+		uint32_t field = CONNMAN_SERVICE_MASK(config_fields[i]);
+
+		if ((mask & field) == 0)
+			continue;
+
+		apply->applied |= field;
+
+		err = send_config_property(apply, config_fields[i], config);
+		if (err < 0) {
+			apply->errors[config_fields[i]] = err;
+			apply->failed |= field;
+		} else
+			apply->pending |= field;
+	}
+
+	if (apply->pending == 0) {
+		g_free(apply);
+		return err;
+	}
+
+	service->refcount++;
+
+	service_if->applies = g_slist_prepend(service_if->applies, apply);
+
+	return 0;
+}
+
+int connman_service_get_connect_timeline(const char *path,
+				struct connman_connect_timeline *timeline,
+				int max)
+{
+	struct connman_service *service;
+	unsigned int i, index;
+
+	if (timeline == NULL || max < 0)
+		return -EINVAL;
+
+	service = get_service(path);
+	if (service == NULL)
+		return -EINVAL;
+
+	if (service->timeline == NULL)
+		return 0;
+
+	/* A deferred Error is recorded once decoded */
+	get_details(service);
+
+	index = service->timeline->last;
+
+	for (i = 0; i < service->timeline->count && i < (unsigned int) max;
+									i++) {
+		timeline[i] = service->timeline->attempts[index];
+		index = (index + CONNECT_TIMELINE_MAX - 1) %
+						CONNECT_TIMELINE_MAX;
+	}
+
+	return i;
+}
+
+static void get_latency(const struct latency_histogram *histogram,
+					struct connman_latency *latency)
+{
+	latency->count = histogram->count;
+	latency->p50 = histogram_percentile(histogram, 50);
+	latency->p95 = histogram_percentile(histogram, 95);
+	latency->p99 = histogram_percentile(histogram, 99);
+}
+
+int connman_service_get_connect_stats(enum connman_tech_type type,
+				struct connman_connect_stats *stats)
+{
+	if (stats == NULL || type >= CONNMAN_TECH_TYPE_MAX)
+		return -EINVAL;
+
+	memset(stats, 0, sizeof(struct connman_connect_stats));
+
+	if (connect_stats[type] == NULL)
+		return 0;
+
+	stats->attempts = connect_stats[type]->attempts;
+	stats->failures = connect_stats[type]->failures;
+	get_latency(&connect_stats[type]->ready, &stats->ready);
+	get_latency(&connect_stats[type]->online, &stats->online);
+
+	return 0;
+}
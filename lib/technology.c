@@ -28,15 +28,18 @@
 
 #define PROPERTY(n) Technology_updatable_properties[n]
 
-static void get_technologies_cb(DBusMessageIter *iter);
+static void get_technologies_cb(DBusMessage *message, DBusMessageIter *iter);
 
 enum connman_technology_property {
-	TECHNOLOGY_POWERED              = 0,
-	TECHNOLOGY_CONNECTED            = 1,
-	TECHNOLOGY_TETHERING            = 2,
-	TECHNOLOGY_TETHERING_IDENTIFIER = 3,
-	TECHNOLOGY_TETHERING_PASSPHRASE = 4,
-	TECHNOLOGY_MAX                  = 5,
+	TECHNOLOGY_POWERED              = CONNMAN_TECHNOLOGY_POWERED,
+	TECHNOLOGY_CONNECTED            = CONNMAN_TECHNOLOGY_CONNECTED,
+	TECHNOLOGY_TETHERING            = CONNMAN_TECHNOLOGY_TETHERING,
+	TECHNOLOGY_TETHERING_IDENTIFIER = CONNMAN_TECHNOLOGY_TETHERING_IDENTIFIER,
+	TECHNOLOGY_TETHERING_PASSPHRASE = CONNMAN_TECHNOLOGY_TETHERING_PASSPHRASE,
+	TECHNOLOGY_MAX                  = CONNMAN_TECHNOLOGY_MAX,
+	TECHNOLOGY_NAME                 = CONNMAN_TECHNOLOGY_NAME,
+	TECHNOLOGY_TYPE                 = CONNMAN_TECHNOLOGY_TYPE,
+	TECHNOLOGY_FIELD_MAX            = 8,
 };
 
 static const char *Technology_updatable_properties[] = {
@@ -47,10 +50,60 @@ static const char *Technology_updatable_properties[] = {
 	"TetheringPassphrase",
 };
 
+static int technology_property_index(const char *name)
+{
+	int index;
+
+	switch (property_key(name)) {
+	case PROPERTY_KEY(7, 'P', 'e', 'd'):
+		index = TECHNOLOGY_POWERED;
+		break;
+	case PROPERTY_KEY(9, 'C', 'n', 'd'):
+		index = TECHNOLOGY_CONNECTED;
+		break;
+	case PROPERTY_KEY(9, 'T', 'h', 'g'):
+		index = TECHNOLOGY_TETHERING;
+		break;
+	case PROPERTY_KEY(19, 'T', 'h', 'r'):
+		index = TECHNOLOGY_TETHERING_IDENTIFIER;
+		break;
+	case PROPERTY_KEY(19, 'T', 'h', 'e'):
+		index = TECHNOLOGY_TETHERING_PASSPHRASE;
+		break;
+	case PROPERTY_KEY(4, 'N', 'e', 'e'):
+		if (strcmp(name, "Name") != 0)
+			return -1;
+		return TECHNOLOGY_NAME;
+	case PROPERTY_KEY(4, 'T', 'e', 'e'):
+		if (strcmp(name, "Type") != 0)
+			return -1;
+		return TECHNOLOGY_TYPE;
+	default:
+		return -1;
+	}
+
+	if (strcmp(name, PROPERTY(index)) != 0)
+		return -1;
+
+	return index;
+}
+
+enum technology_backing {
+	BACKING_TETHERING_IDENTIFIER = 0,
+	BACKING_TETHERING_PASSPHRASE = 1,
+	BACKING_MAX                  = 2,
+};
+
+struct scan_request {
+	connman_scan_cb_f callback;
+	void *user_data;
+};
+
 struct connman_technology {
 	char *path;
-	char *name;
-	char *type;
+	const char *name;
+	const char *type;
+	enum connman_tech_type type_id;
 
 	gboolean powered;
 	gboolean connected;
@@ -59,29 +112,51 @@ struct connman_technology {
 	char *tethering_identifier;
 	char *tethering_passphrase;
 
+	/* Generation of the last field change, and of each field's */
+	uint32_t generation;
+	uint32_t field_generation[TECHNOLOGY_FIELD_MAX];
+
 	int update_index;
+	DBusMessage *backing[BACKING_MAX];
 
-	guint property_changed_wid;
-	guint to_update[TECHNOLOGY_MAX];
+	/* Changed properties, queued in dirty_techs until flushed */
+	uint32_t dirty;
+	gboolean queued;
 	connman_property_changed_cb_f property_changed_cb;
 	void *property_changed_user_data;
 
-	connman_scan_cb_f scan_cb;
+	/* Requests wait for scan_call, or to_scan_done if last_scan is fresh */
+	gint64 last_scan;
 	DBusPendingCall *scan_call;
-	void *scan_user_data;
+	guint to_scan_done;
+	GSList *scan_requests;
 
 	DBusPendingCall *call_modify[TECHNOLOGY_MAX];
+	/* Message of the pending call, for the value it applied */
+	DBusMessage *sent_modify[TECHNOLOGY_MAX];
+	/* Last value set while the call was pending, sent on its reply */
+	DBusMessage *queued_modify[TECHNOLOGY_MAX];
 	guint to_error[TECHNOLOGY_MAX];
 	connman_property_set_cb_f property_set_error_cb;
 	void *property_set_error_user_data;
+	connman_property_applied_cb_f property_applied_cb;
+	void *property_applied_user_data;
 };
 
 struct connman_technology_interface {
 	DBusConnection *dbus_cnx;
 
+	/* Watches PropertyChanged for all the technologies at once */
+	guint property_changed_wid;
+
 	GHashTable *techs;
 	gboolean set;
 
+	struct connman_technology *by_type[CONNMAN_TECH_TYPE_MAX];
+
+	GPtrArray *dirty_techs;
+	guint to_flush;
+
 	connman_property_changed_cb_f property_changed_cb;
 	void *property_user_data;
 
@@ -91,24 +166,38 @@ struct connman_technology_interface {
 
 static struct connman_technology_interface *tech_if = NULL;
 
+/* Strings are borrowed from the D-Bus messages when set */
+static gboolean borrow_strings = FALSE;
+
+/* Scans completed since less than that are not run again, in microseconds */
+static gint64 scan_max_age = 0;
+
 static void technology_free(gpointer data)
 {
 	struct connman_technology *technology = data;
 	int i;
 
-	if (technology->property_changed_wid != 0)
-		g_dbus_remove_watch(tech_if->dbus_cnx,
-					technology->property_changed_wid);
+	if (tech_if->by_type[technology->type_id] == technology)
+		tech_if->by_type[technology->type_id] = NULL;
 
-	for (i = 0; i < TECHNOLOGY_MAX; i++) {
-		if (technology->to_update[i] != 0)
-			g_source_remove(technology->to_update[i]);
+	if (technology->queued == TRUE) {
+		for (i = 0; i < (int) tech_if->dirty_techs->len; i++) {
+			if (g_ptr_array_index(tech_if->dirty_techs, i) ==
+								technology)
+				tech_if->dirty_techs->pdata[i] = NULL;
+		}
+	}
 
+	for (i = 0; i < TECHNOLOGY_MAX; i++) {
 		if (technology->call_modify[i] != 0) {
 			dbus_pending_call_cancel(technology->call_modify[i]);
 			dbus_pending_call_unref(technology->call_modify[i]);
+			dbus_message_unref(technology->sent_modify[i]);
 		}
 
+		if (technology->queued_modify[i] != NULL)
+			dbus_message_unref(technology->queued_modify[i]);
+
 		if (technology->to_error[i] != 0)
 			g_source_remove(technology->to_error[i]);
 	}
@@ -118,11 +207,21 @@ static void technology_free(gpointer data)
 		dbus_pending_call_unref(technology->scan_call);
 	}
 
+	if (technology->to_scan_done != 0)
+		g_source_remove(technology->to_scan_done);
+
+	g_slist_free_full(technology->scan_requests, g_free);
+
+	__connman_message_drop_templates(technology->path);
+
 	g_free(technology->path);
-	g_free(technology->name);
-	g_free(technology->type);
-	g_free(technology->tethering_identifier);
-	g_free(technology->tethering_passphrase);
+	if (technology->backing[BACKING_TETHERING_IDENTIFIER] == NULL)
+		g_free(technology->tethering_identifier);
+	if (technology->backing[BACKING_TETHERING_PASSPHRASE] == NULL)
+		g_free(technology->tethering_passphrase);
+
+	for (i = 0; i < BACKING_MAX; i++)
+		set_backing(&technology->backing[i], NULL);
 
 	g_free(technology);
 }
@@ -141,130 +240,257 @@ static void destroy_property(gpointer user_data)
 	struct connman_technology *technology;
 
 	technology = get_technology(property->path);
-	if (technology != NULL) {
-		if (property->error != 0)
-			technology->to_error[property->index] = 0;
-		else
-			technology->to_update[property->index] = 0;
-	}
+	if (technology != NULL)
+		technology->to_error[property->index] = 0;
 
 	g_free(property);
 }
 
-static gboolean property_changed_or_error(gpointer user_data)
+static gboolean property_error(gpointer user_data)
 {
 	struct property_change *property = user_data;
 	struct connman_technology *technology;
 
 	technology = get_technology(property->path);
-	if (technology == NULL)
+	if (technology == NULL || technology->property_set_error_cb == NULL)
 		return FALSE;
 
-	if (property->error != 0) {
-		if (technology->property_set_error_cb == NULL)
-			return FALSE;
-
-		technology->property_set_error_cb(property->path,
+	technology->property_set_error_cb(property->path,
 				property->name, property->error,
 				technology->property_set_error_user_data);
+
+	return FALSE;
+}
+
+static void property_update(struct connman_technology *technology, int index);
+
+/* A technology freed from a callback is cleared from dirty_techs */
+static gboolean is_flushing(struct connman_technology *technology,
+							unsigned int position)
+{
+	if (tech_if == NULL || position >= tech_if->dirty_techs->len)
 		return FALSE;
-	}
 
-	if (tech_if->property_changed_cb != NULL) {
-		tech_if->property_changed_cb(property->path, property->name,
+	return g_ptr_array_index(tech_if->dirty_techs, position) == technology;
+}
+
+/* Returns FALSE if the technology went away from a callback */
+static gboolean notify_technology(struct connman_technology *technology,
+							unsigned int position)
+{
+	uint32_t dirty = technology->dirty;
+	int i;
+
+	technology->dirty = 0;
+
+	for (i = 0; i < TECHNOLOGY_MAX; i++) {
+		if ((dirty & (1 << i)) == 0)
+			continue;
+
+		if (tech_if->property_changed_cb != NULL)
+			tech_if->property_changed_cb(technology->path,
+						PROPERTY(i),
 						tech_if->property_user_data);
+
+		if (is_flushing(technology, position) == TRUE &&
+				technology->property_changed_cb != NULL)
+			technology->property_changed_cb(technology->path,
+					PROPERTY(i),
+					technology->property_changed_user_data);
+
+		if (is_flushing(technology, position) == FALSE)
+			return FALSE;
 	}
 
-	if (technology->property_changed_cb != NULL) {
-		technology->property_changed_cb(property->path, property->name,
-				technology->property_changed_user_data);
+	return TRUE;
+}
+
+static gboolean flush_properties(gpointer user_data)
+{
+	struct connman_technology *technology;
+	GPtrArray *dirty;
+	unsigned int length, i;
+
+	if (tech_if == NULL)
+		return FALSE;
+
+	tech_if->to_flush = 0;
+
+	/* What changes from the callbacks is left to the next flush */
+	dirty = tech_if->dirty_techs;
+	length = dirty->len;
+
+	/* The callbacks may also clear the queue */
+	for (i = 0; i < length && i < dirty->len; i++) {
+		technology = g_ptr_array_index(dirty, i);
+		if (technology == NULL)
+			continue;
+
+		if (notify_technology(technology, i) == FALSE) {
+			if (tech_if == NULL)
+				return FALSE;
+
+			continue;
+		}
+
+		dirty->pdata[i] = NULL;
+		technology->queued = FALSE;
+
+		if (technology->dirty != 0)
+			property_update(technology, -1);
 	}
 
+	remove_flushed(dirty, length);
+
 	return FALSE;
 }
 
-static void property_update(struct connman_technology *technology, int index)
+static void set_technology_type(struct connman_technology *technology,
+							const char *type)
 {
-	struct property_change *property;
+	if (tech_if->by_type[technology->type_id] == technology)
+		tech_if->by_type[technology->type_id] = NULL;
+
+	technology->type = connman_intern(type);
+	technology->type_id = string2enum_tech_type(type);
+
+	if (technology->type_id != CONNMAN_TECH_TYPE_UNKNOWN)
+		tech_if->by_type[technology->type_id] = technology;
+}
+
+static void clear_dirty_techs(void)
+{
+	struct connman_technology *technology;
+	unsigned int i;
+
+	for (i = 0; i < tech_if->dirty_techs->len; i++) {
+		technology = g_ptr_array_index(tech_if->dirty_techs, i);
+		if (technology == NULL)
+			continue;
+
+		technology->dirty = 0;
+		technology->queued = FALSE;
+	}
+
+	g_ptr_array_set_size(tech_if->dirty_techs, 0);
+}
 
+/* An index of -1 only queues what is already dirty */
+static void property_update(struct connman_technology *technology, int index)
+{
 	if (technology->property_changed_cb == NULL)
 		return;
 
-	property = g_try_malloc0(sizeof(struct property_change));
-	if (property == NULL)
-		return;
+	if (index >= 0)
+		technology->dirty |= 1 << index;
 
-	property->index = index;
-	property->name = PROPERTY(index);
-	property->path = technology->path;
+	if (technology->queued == FALSE) {
+		technology->queued = TRUE;
+		g_ptr_array_add(tech_if->dirty_techs, technology);
+	}
+
+	if (tech_if->to_flush == 0)
+		tech_if->to_flush = g_timeout_add_full(G_PRIORITY_DEFAULT, 0,
+						flush_properties, NULL, NULL);
+}
 
-	if (technology->to_update[index] != 0)
-		g_source_remove(technology->to_update[index]);
+/* Fields are stamped when first set, and then only when they change */
+static void stamp_field(struct connman_technology *technology, int index,
+							gboolean changed)
+{
+	if (changed == FALSE && technology->field_generation[index] != 0)
+		return;
 
-	technology->to_update[index] = g_timeout_add_full(G_PRIORITY_DEFAULT,
-						0, property_changed_or_error,
-						property, destroy_property);
+	technology->generation = __connman_generation_next();
+	technology->field_generation[index] = technology->generation;
 }
 
-static bool update_technology_property(DBusMessageIter *arg, void *user_data)
+static void update_technology_property(struct connman_technology *technology,
+				DBusMessage *message, DBusMessageIter *arg)
 {
-	struct connman_technology *technology = user_data;
-	const char *name, *value;
+	const char *name, *value = NULL;
+	dbus_bool_t boolean = FALSE;
+	gboolean changed = FALSE;
+	int index;
 
 	if (cui_dbus_get_basic(arg, DBUS_TYPE_STRING, &name) != 0)
-		return FALSE;
+		return;
 
 	dbus_message_iter_next(arg);
 
-	if (g_strcmp0(name, "Name") == 0) {
+	index = technology_property_index(name);
+
+	switch (index) {
+	case TECHNOLOGY_NAME:
 		cui_dbus_get_basic_variant(arg, DBUS_TYPE_STRING, &value);
-		technology->name = g_strdup(value);
-	} else if (g_strcmp0(name, "Type") == 0) {
+		changed = technology->name != connman_intern(value);
+		technology->name = connman_intern(value);
+		break;
+	case TECHNOLOGY_TYPE:
 		cui_dbus_get_basic_variant(arg, DBUS_TYPE_STRING, &value);
-		technology->type = g_strdup(value);
-	} else if (g_strcmp0(name, PROPERTY(TECHNOLOGY_POWERED)) == 0) {
-		cui_dbus_get_basic_variant(arg,
-				DBUS_TYPE_BOOLEAN, &technology->powered);
-		technology->update_index = TECHNOLOGY_POWERED;
-	} else if (g_strcmp0(name, PROPERTY(TECHNOLOGY_CONNECTED)) == 0) {
-		cui_dbus_get_basic_variant(arg,
-				DBUS_TYPE_BOOLEAN, &technology->connected);
-		technology->update_index = TECHNOLOGY_CONNECTED;
-	} else if (g_strcmp0(name, PROPERTY(TECHNOLOGY_TETHERING)) == 0) {
-		cui_dbus_get_basic_variant(arg,
-				DBUS_TYPE_BOOLEAN, &technology->tethering);
-		technology->update_index = TECHNOLOGY_TETHERING;;
-	} else if (g_strcmp0(name,
-			PROPERTY(TECHNOLOGY_TETHERING_IDENTIFIER)) == 0) {
+		changed = technology->type != connman_intern(value);
+		set_technology_type(technology, value);
+		break;
+	case TECHNOLOGY_POWERED:
+		cui_dbus_get_basic_variant(arg, DBUS_TYPE_BOOLEAN, &boolean);
+		changed = technology->powered != boolean;
+		technology->powered = boolean;
+		break;
+	case TECHNOLOGY_CONNECTED:
+		cui_dbus_get_basic_variant(arg, DBUS_TYPE_BOOLEAN, &boolean);
+		changed = technology->connected != boolean;
+		technology->connected = boolean;
+		break;
+	case TECHNOLOGY_TETHERING:
+		cui_dbus_get_basic_variant(arg, DBUS_TYPE_BOOLEAN, &boolean);
+		changed = technology->tethering != boolean;
+		technology->tethering = boolean;
+		break;
+	case TECHNOLOGY_TETHERING_IDENTIFIER:
 		cui_dbus_get_basic_variant(arg, DBUS_TYPE_STRING, &value);
-
-		g_free(technology->tethering_identifier);
-		technology->tethering_identifier = g_strdup(value);
-
-		technology->update_index = TECHNOLOGY_TETHERING_IDENTIFIER;
-	} else if (g_strcmp0(name,
-			PROPERTY(TECHNOLOGY_TETHERING_PASSPHRASE)) == 0) {
+		changed = g_strcmp0(technology->tethering_identifier,
+								value) != 0;
+
+		technology->tethering_identifier = update_string(
+			technology->tethering_identifier, value,
+			&technology->backing[BACKING_TETHERING_IDENTIFIER],
+			message);
+		break;
+	case TECHNOLOGY_TETHERING_PASSPHRASE:
 		cui_dbus_get_basic_variant(arg, DBUS_TYPE_STRING, &value);
-
-		g_free(technology->tethering_passphrase);
-		technology->tethering_passphrase = g_strdup(value);
-
-		technology->update_index = TECHNOLOGY_TETHERING_PASSPHRASE;
+		changed = g_strcmp0(technology->tethering_passphrase,
+								value) != 0;
+
+		technology->tethering_passphrase = update_string(
+			technology->tethering_passphrase, value,
+			&technology->backing[BACKING_TETHERING_PASSPHRASE],
+			message);
+		break;
+	default:
+		break;
 	}
 
-	if (technology->update_index < TECHNOLOGY_MAX)
-		property_update(technology, technology->update_index);
+	if (index >= 0 && index < TECHNOLOGY_FIELD_MAX)
+		stamp_field(technology, index, changed);
 
-	return FALSE;
+	if (index >= 0 && index < TECHNOLOGY_MAX) {
+		technology->update_index = index;
+		property_update(technology, index);
+	}
 }
 
 static gboolean property_changed_signal_cb(DBusConnection *dbus_cnx,
 					DBusMessage *message, void *user_data)
 {
-	struct connman_technology *technology = user_data;
+	struct connman_technology *technology;
 	DBusMessageIter arg;
 
-	if (message == NULL)
+	if (message == NULL || tech_if == NULL)
+		return TRUE;
+
+	technology = g_hash_table_lookup(tech_if->techs,
+					dbus_message_get_path(message));
+	if (technology == NULL)
 		return TRUE;
 
 	if (dbus_message_iter_init(message, &arg) == FALSE)
@@ -272,13 +498,114 @@ static gboolean property_changed_signal_cb(DBusConnection *dbus_cnx,
 
 	technology->update_index = TECHNOLOGY_MAX;
 
-	update_technology_property(&arg, technology);
+	update_technology_property(technology,
+			borrow_strings == TRUE ? message : NULL, &arg);
 
 	return TRUE;
 }
 
-static void update_or_create_technology(const char *obj_path,
-					DBusMessageIter *dict)
+struct technology_properties {
+	dbus_bool_t powered;
+	dbus_bool_t connected;
+	dbus_bool_t tethering;
+	const char *tethering_identifier;
+	const char *tethering_passphrase;
+	const char *name;
+	const char *type;
+};
+
+/* The first TECHNOLOGY_MAX entries follow the property enumeration */
+static const struct cui_dbus_dict_spec technology_spec[] = {
+	CUI_DBUS_DICT_BASIC("Powered", DBUS_TYPE_BOOLEAN,
+			struct technology_properties, powered),
+	CUI_DBUS_DICT_BASIC("Connected", DBUS_TYPE_BOOLEAN,
+			struct technology_properties, connected),
+	CUI_DBUS_DICT_BASIC("Tethering", DBUS_TYPE_BOOLEAN,
+			struct technology_properties, tethering),
+	CUI_DBUS_DICT_BASIC("TetheringIdentifier", DBUS_TYPE_STRING,
+			struct technology_properties, tethering_identifier),
+	CUI_DBUS_DICT_BASIC("TetheringPassphrase", DBUS_TYPE_STRING,
+			struct technology_properties, tethering_passphrase),
+	CUI_DBUS_DICT_BASIC("Name", DBUS_TYPE_STRING,
+			struct technology_properties, name),
+	CUI_DBUS_DICT_BASIC("Type", DBUS_TYPE_STRING,
+			struct technology_properties, type),
+	CUI_DBUS_DICT_SPEC_END,
+};
+
+static void update_technology_properties(struct connman_technology *technology,
+				DBusMessage *message, DBusMessageIter *dict)
+{
+	struct technology_properties properties;
+	uint32_t found;
+	int i;
+
+	if (cui_dbus_get_dict(dict, technology_spec, &properties, &found) < 0)
+		return;
+
+	if (borrow_strings == FALSE)
+		message = NULL;
+
+	if (found & (1 << TECHNOLOGY_MAX)) {
+		stamp_field(technology, TECHNOLOGY_NAME, technology->name !=
+					connman_intern(properties.name));
+		technology->name = connman_intern(properties.name);
+	}
+
+	if (found & (1 << (TECHNOLOGY_MAX + 1))) {
+		stamp_field(technology, TECHNOLOGY_TYPE, technology->type !=
+					connman_intern(properties.type));
+		set_technology_type(technology, properties.type);
+	}
+
+	if (found & (1 << TECHNOLOGY_POWERED)) {
+		stamp_field(technology, TECHNOLOGY_POWERED,
+				technology->powered != properties.powered);
+		technology->powered = properties.powered;
+	}
+
+	if (found & (1 << TECHNOLOGY_CONNECTED)) {
+		stamp_field(technology, TECHNOLOGY_CONNECTED,
+				technology->connected != properties.connected);
+		technology->connected = properties.connected;
+	}
+
+	if (found & (1 << TECHNOLOGY_TETHERING)) {
+		stamp_field(technology, TECHNOLOGY_TETHERING,
+				technology->tethering != properties.tethering);
+		technology->tethering = properties.tethering;
+	}
+
+	if (found & (1 << TECHNOLOGY_TETHERING_IDENTIFIER)) {
+		stamp_field(technology, TECHNOLOGY_TETHERING_IDENTIFIER,
+			g_strcmp0(technology->tethering_identifier,
+				properties.tethering_identifier) != 0);
+		technology->tethering_identifier = update_string(
+			technology->tethering_identifier,
+			properties.tethering_identifier,
+			&technology->backing[BACKING_TETHERING_IDENTIFIER],
+			message);
+	}
+
+	if (found & (1 << TECHNOLOGY_TETHERING_PASSPHRASE)) {
+		stamp_field(technology, TECHNOLOGY_TETHERING_PASSPHRASE,
+			g_strcmp0(technology->tethering_passphrase,
+				properties.tethering_passphrase) != 0);
+		technology->tethering_passphrase = update_string(
+			technology->tethering_passphrase,
+			properties.tethering_passphrase,
+			&technology->backing[BACKING_TETHERING_PASSPHRASE],
+			message);
+	}
+
+	for (i = 0; i < TECHNOLOGY_MAX; i++) {
+		if (found & (1 << i))
+			property_update(technology, i);
+	}
+}
+
+static void update_or_create_technology(DBusMessage *message,
+				const char *obj_path, DBusMessageIter *dict)
 {
 	struct connman_technology *technology;
 
@@ -295,22 +622,12 @@ static void update_or_create_technology(const char *obj_path,
 
 		g_hash_table_insert(tech_if->techs,
 					technology->path, technology);
-
-		technology->property_changed_wid = g_dbus_add_signal_watch(
-						tech_if->dbus_cnx,
-						CONNMAN_DBUS_NAME,
-						technology->path,
-						CONNMAN_TECHNOLOGY_INTERFACE,
-						"PropertyChanged",
-						property_changed_signal_cb,
-						technology, NULL);
 	}
 
-	cui_dbus_foreach_dict_entry(dict,
-			update_technology_property, technology);
+	update_technology_properties(technology, message, dict);
 }
 
-static void technology_added_cb(DBusMessageIter *iter)
+static void technology_added_cb(DBusMessage *message, DBusMessageIter *iter)
 {
 	char *obj_path;
 
@@ -321,7 +638,7 @@ static void technology_added_cb(DBusMessageIter *iter)
 
 	dbus_message_iter_next(iter);
 
-	update_or_create_technology(obj_path, iter);
+	update_or_create_technology(message, obj_path, iter);
 
 	if (tech_if != NULL && tech_if->added_cb != NULL)
 		tech_if->added_cb(obj_path);
@@ -345,7 +662,7 @@ static void technology_removed_cb(DBusMessageIter *iter)
 	g_hash_table_remove(tech_if->techs, obj_path);
 }
 
-static void get_technologies_cb(DBusMessageIter *iter)
+static void get_technologies_cb(DBusMessage *message, DBusMessageIter *iter)
 {
 	DBusMessageIter array;
 	DBusMessageIter strt;
@@ -367,7 +684,7 @@ static void get_technologies_cb(DBusMessageIter *iter)
 		cui_dbus_get_basic(&strt, DBUS_TYPE_OBJECT_PATH, &obj_path);
 
 		dbus_message_iter_next(&strt);
-		update_or_create_technology(obj_path, &strt);
+		update_or_create_technology(message, obj_path, &strt);
 
 		dbus_message_iter_next(&array);
 		arg_type = dbus_message_iter_get_arg_type(&array);
@@ -383,18 +700,86 @@ static void get_technologies_cb(DBusMessageIter *iter)
 	}
 }
 
+static void complete_scan_requests(struct connman_technology *technology)
+{
+	GSList *requests = technology->scan_requests;
+	GSList *list;
+
+	/* Callbacks may scan again */
+	technology->scan_requests = NULL;
+
+	for (list = requests; list != NULL; list = list->next) {
+		struct scan_request *request = list->data;
+
+		if (request->callback != NULL)
+			request->callback(request->user_data);
+	}
+
+	g_slist_free_full(requests, g_free);
+}
+
+static gboolean scan_done(gpointer user_data)
+{
+	struct connman_technology *technology = user_data;
+
+	technology->to_scan_done = 0;
+
+	/* Those requests are completed along with the running scan */
+	if (technology->scan_call == NULL)
+		complete_scan_requests(technology);
+
+	return FALSE;
+}
+
 static void scan_callback(DBusPendingCall *pending, void *user_data)
 {
 	struct connman_technology *technology = user_data;
+	DBusMessage *reply;
 
 	if (dbus_pending_call_get_completed(pending) == FALSE)
 		return;
 
+	reply = dbus_pending_call_steal_reply(pending);
+	if (reply != NULL) {
+		if (dbus_message_get_type(reply) != DBUS_MESSAGE_TYPE_ERROR)
+			technology->last_scan = g_get_monotonic_time();
+
+		dbus_message_unref(reply);
+	}
+
 	dbus_pending_call_unref(pending);
 	technology->scan_call = NULL;
 
-	if (technology->scan_cb != NULL)
-		technology->scan_cb(technology->scan_user_data);
+	complete_scan_requests(technology);
+}
+
+static int send_property_message(struct connman_technology *technology,
+				enum connman_technology_property property,
+				DBusMessage *message);
+
+static void property_applied(struct connman_technology *technology,
+				int index, DBusMessage *message, int error)
+{
+	struct connman_value value, *applied = NULL;
+	DBusMessageIter iter, variant;
+
+	if (technology->property_applied_cb == NULL)
+		return;
+
+	/* Past the name of the property, to its value */
+	if (dbus_message_iter_init(message, &iter) == TRUE &&
+				dbus_message_iter_next(&iter) == TRUE &&
+				dbus_message_iter_get_arg_type(&iter) ==
+							DBUS_TYPE_VARIANT) {
+		dbus_message_iter_recurse(&iter, &variant);
+
+		if (__connman_get_value(&variant, &value) == TRUE)
+			applied = &value;
+	}
+
+	technology->property_applied_cb(technology->path, PROPERTY(index),
+				applied, error,
+				technology->property_applied_user_data);
 }
 
 static void set_property_cb(DBusPendingCall *pending, void *user_data)
@@ -402,8 +787,9 @@ static void set_property_cb(DBusPendingCall *pending, void *user_data)
 	struct property_setting *set = user_data;
 	struct connman_technology *technology;
 	struct property_change *property;
-	DBusMessage *reply;
+	DBusMessage *reply = NULL, *message, *queued;
 	DBusError error;
+	int index, err;
 
 	if (dbus_pending_call_get_completed(pending) == FALSE)
 		return;
@@ -412,105 +798,155 @@ static void set_property_cb(DBusPendingCall *pending, void *user_data)
 		return;
 
 	technology = set->data;
+	index = set->index;
 
-	technology->call_modify[set->index] = NULL;
+	dbus_pending_call_unref(technology->call_modify[index]);
+	technology->call_modify[index] = NULL;
 
-	if (technology->property_set_error_cb == NULL)
-		return;
+	message = technology->sent_modify[index];
+	technology->sent_modify[index] = NULL;
 
-	property = g_try_malloc0(sizeof(struct property_change));
-	if (property == NULL)
-		return;
+	/* Only the outcome of the last value set is reported */
+	queued = technology->queued_modify[index];
+	if (queued != NULL) {
+		technology->queued_modify[index] = NULL;
 
-	reply = dbus_pending_call_steal_reply(pending);
-	if (reply == NULL)
-		return;
+		err = send_property_message(technology, index, queued);
+		dbus_message_unref(queued);
+
+		if (err == 0)
+			goto done;
+	}
 
 	dbus_error_init(&error);
-	if (dbus_set_error_from_message(&error, reply) == FALSE)
-		goto done;
+	err = 0;
+
+	reply = dbus_pending_call_steal_reply(pending);
+	if (reply == NULL)
+		err = -EIO;
+	else if (dbus_set_error_from_message(&error, reply) == TRUE) {
+		printf("SetProperty Error: %s\n", error.message);
+		err = __connman_error2errno(error.name);
+		dbus_error_free(&error);
+	}
 
-	printf("SetProperty Error: %s\n", error.message);
-	dbus_error_free(&error);
+	property_applied(technology, index, message, err);
 
-	if (technology->property_set_error_cb == NULL)
+	if (reply == NULL || err == 0 ||
+				technology->property_set_error_cb == NULL)
 		goto done;
 
 	property = g_try_malloc0(sizeof(struct property_change));
 	if (property == NULL)
 		goto done;
 
+	property->index = index;
 	property->path = technology->path;
-	property->name = PROPERTY(set->index);
+	property->name = PROPERTY(index);
 	property->error = -1;
 
-	if (technology->to_error[set->index] != 0)
-		g_source_remove(technology->to_error[set->index]);
+	if (technology->to_error[index] != 0)
+		g_source_remove(technology->to_error[index]);
 
-	technology->to_error[set->index] = g_timeout_add_full(
+	technology->to_error[index] = g_timeout_add_full(
 						G_PRIORITY_DEFAULT,
-						0, property_changed_or_error,
+						0, property_error,
 						property, destroy_property);
 
 done:
-	dbus_message_unref(reply);
+	if (reply != NULL)
+		dbus_message_unref(reply);
+
+	dbus_message_unref(message);
 }
 
-static int set_technology_property(struct connman_technology *technology,
+/*
+ * While a call is pending for that property, message replaces any value
+ * queued after it instead of being sent: the last one is sent once the
+ * pending call completes.
+ */
+static int send_property_message(struct connman_technology *technology,
 				enum connman_technology_property property,
-				int dbus_type, void *data)
+				DBusMessage *message)
 {
-	struct property_setting *set = NULL;
-	const char *property_name;
-	DBusMessage *message;
-	DBusMessageIter arg;
+	struct property_setting *set;
 
-	if (connman == NULL)
-		return -EINVAL;
+	if (technology->call_modify[property] != NULL) {
+		if (technology->queued_modify[property] != NULL)
+			dbus_message_unref(technology->queued_modify[property]);
 
-	if (technology->call_modify[property] != NULL)
-		return -EINVAL;
+		technology->queued_modify[property] =
+						dbus_message_ref(message);
 
-	message = dbus_message_new_method_call(CONNMAN_DBUS_NAME,
-						technology->path,
-						CONNMAN_TECHNOLOGY_INTERFACE,
-						"SetProperty");
-	if (message == NULL)
-		return -ENOMEM;
+		return 0;
+	}
 
 	set = g_try_malloc0(sizeof(struct property_setting));
 	if (set == NULL)
-		goto error;
+		return -ENOMEM;
 
 	set->data = technology;
 	set->index = property;
 
-	property_name = PROPERTY(property);
-
-	dbus_message_iter_init_append(message, &arg);
-
-	cui_dbus_append_basic(&arg, property_name, dbus_type, data);
-
 	if (dbus_connection_send_with_reply(tech_if->dbus_cnx, message,
 					&technology->call_modify[property],
-					DBUS_TIMEOUT_USE_DEFAULT) == FALSE)
-		goto error;
+					DBUS_TIMEOUT_USE_DEFAULT) == FALSE) {
+		g_free(set);
+		return -EINVAL;
+	}
 
 	if (dbus_pending_call_set_notify(technology->call_modify[property],
-					set_property_cb, set, g_free) == FALSE)
-		goto error;
+				set_property_cb, set, g_free) == FALSE) {
+		dbus_pending_call_cancel(technology->call_modify[property]);
+		dbus_pending_call_unref(technology->call_modify[property]);
+		technology->call_modify[property] = NULL;
+		g_free(set);
+		return -EINVAL;
+	}
+
+	technology->sent_modify[property] = dbus_message_ref(message);
 
 	return 0;
+}
 
-error:
-	dbus_message_unref(message);
+static int set_technology_property(struct connman_technology *technology,
+				enum connman_technology_property property,
+				int dbus_type, void *data)
+{
+	const char *property_name;
+	DBusMessage *message;
+	int err;
 
-	if (set == NULL)
+	if (connman == NULL)
+		return -EINVAL;
+
+	message = __connman_message_new_method_call(technology->path,
+					CONNMAN_TECHNOLOGY_INTERFACE,
+					"SetProperty", "sv");
+	if (message == NULL)
 		return -ENOMEM;
 
-	g_free(set);
+	property_name = PROPERTY(property);
 
-	return -EINVAL;
+	if (cui_dbus_append_set_property(message, property_name,
+						dbus_type, data) < 0)
+		err = -EINVAL;
+	else
+		err = send_property_message(technology, property, message);
+
+	dbus_message_unref(message);
+
+	return err;
+}
+
+void connman_technology_set_borrowed_strings(gboolean enable)
+{
+	borrow_strings = enable;
+}
+
+void connman_technology_set_scan_max_age(unsigned int seconds)
+{
+	scan_max_age = (gint64) seconds * G_USEC_PER_SEC;
 }
 
 int connman_technology_init(void)
@@ -534,12 +970,22 @@ int connman_technology_init(void)
 		return -ENOMEM;
 	}
 
+	tech_if->dirty_techs = g_ptr_array_new();
+
 	ret = __connman_manager_get_technologies(get_technologies_cb);
 	if (ret < 0)
 		return ret;
 
 	tech_if->dbus_cnx = dbus_connection_ref(connman->dbus_cnx);
 
+	tech_if->property_changed_wid = g_dbus_add_signal_watch(
+						tech_if->dbus_cnx,
+						CONNMAN_DBUS_NAME, NULL,
+						CONNMAN_TECHNOLOGY_INTERFACE,
+						"PropertyChanged",
+						property_changed_signal_cb,
+						NULL, NULL);
+
 	return 0;
 }
 
@@ -550,9 +996,18 @@ void connman_technology_finalize(void)
 
 	__connman_manager_register_technology_signals(NULL, NULL);
 
+	if (tech_if->property_changed_wid != 0)
+		g_dbus_remove_watch(tech_if->dbus_cnx,
+					tech_if->property_changed_wid);
+
 	dbus_connection_unref(tech_if->dbus_cnx);
 
+	if (tech_if->to_flush != 0)
+		g_source_remove(tech_if->to_flush);
+
+	clear_dirty_techs();
 	g_hash_table_destroy(tech_if->techs);
+	g_ptr_array_free(tech_if->dirty_techs, TRUE);
 
 	g_free(tech_if);
 
@@ -598,6 +1053,20 @@ void connman_technology_set_property_error_callback(const char *path,
 	technology->property_set_error_user_data = user_data;
 }
 
+void connman_technology_set_property_applied_callback(const char *path,
+			connman_property_applied_cb_f property_applied_cb,
+			void *user_data)
+{
+	struct connman_technology *technology;
+
+	technology = get_technology(path);
+	if (technology == NULL)
+		return;
+
+	technology->property_applied_cb = property_applied_cb;
+	technology->property_applied_user_data = user_data;
+}
+
 void connman_technology_set_removed_callback(
 					connman_path_changed_cb_f removed_cb)
 {
@@ -611,6 +1080,14 @@ void connman_technology_set_added_callback(connman_path_changed_cb_f added_cb)
 		tech_if->added_cb = added_cb;
 }
 
+int __connman_technology_count(void)
+{
+	if (tech_if == NULL || tech_if->techs == NULL)
+		return 0;
+
+	return g_hash_table_size(tech_if->techs);
+}
+
 GList *connman_technology_get_technologies(void)
 {
 	if (tech_if == NULL || tech_if->techs == NULL)
@@ -623,20 +1100,41 @@ int connman_technology_scan(const char *path,
 				connman_scan_cb_f callback, void *user_data)
 {
 	struct connman_technology *technology;
+	struct scan_request *request;
 	DBusMessage *message;
 
 	technology = get_technology(path);
 	if (technology == NULL)
 		return -EINVAL;
 
-	message = dbus_message_new_method_call(CONNMAN_DBUS_NAME,
-						technology->path,
-						CONNMAN_TECHNOLOGY_INTERFACE,
-						"Scan");
-	if (message == NULL)
+	request = g_try_malloc0(sizeof(struct scan_request));
+	if (request == NULL)
 		return -ENOMEM;
 
-	technology->scan_cb = callback;
+	request->callback = callback;
+	request->user_data = user_data;
+
+	/* Merged into the scan already running */
+	if (technology->scan_call != NULL)
+		goto queue;
+
+	/* Results of the last scan are still fresh enough */
+	if (technology->last_scan != 0 && g_get_monotonic_time() -
+				technology->last_scan < scan_max_age) {
+		if (technology->to_scan_done == 0)
+			technology->to_scan_done = g_timeout_add_full(
+						G_PRIORITY_DEFAULT, 0,
+						scan_done, technology, NULL);
+		goto queue;
+	}
+
+	message = __connman_message_new_method_call(technology->path,
+						CONNMAN_TECHNOLOGY_INTERFACE,
+						"Scan", NULL);
+	if (message == NULL) {
+		g_free(request);
+		return -ENOMEM;
+	}
 
 	if (dbus_connection_send_with_reply(tech_if->dbus_cnx, message,
 				&technology->scan_call,
@@ -644,19 +1142,25 @@ int connman_technology_scan(const char *path,
 		goto error;
 
 	if (dbus_pending_call_set_notify(technology->scan_call,
-				scan_callback, technology, NULL) == FALSE)
+				scan_callback, technology, NULL) == FALSE) {
+		dbus_pending_call_cancel(technology->scan_call);
+		dbus_pending_call_unref(technology->scan_call);
+		technology->scan_call = NULL;
 		goto error;
-
-	technology->scan_user_data = user_data;
+	}
 
 	dbus_message_unref(message);
 
+queue:
+	technology->scan_requests = g_slist_append(technology->scan_requests,
+								request);
+
 	return 0;
 
 error:
 	dbus_message_unref(message);
 
-	technology->scan_cb = NULL;
+	g_free(request);
 
 	return -EINVAL;
 }
@@ -669,7 +1173,8 @@ int connman_technology_enable(const char *path, gboolean enable)
 	if (technology == NULL)
 		return -EINVAL;
 
-	if (technology->powered == enable)
+	if (technology->call_modify[TECHNOLOGY_POWERED] == NULL &&
+					technology->powered == enable)
 		return 0;
 
 	return set_technology_property(technology,
@@ -685,7 +1190,8 @@ int connman_technology_tether(const char *path, gboolean tethering)
 	if (technology == NULL)
 		return -EINVAL;
 
-	if (technology->tethering == tethering)
+	if (technology->call_modify[TECHNOLOGY_TETHERING] == NULL &&
+					technology->tethering == tethering)
 		return 0;
 
 	return set_technology_property(technology,
@@ -743,6 +1249,29 @@ const char *connman_technology_get_type(const char *path)
 	return technology->type;
 }
 
+enum connman_tech_type connman_technology_get_type_id(const char *path)
+{
+	struct connman_technology *technology;
+
+	technology = get_technology(path);
+	if (technology == NULL)
+		return CONNMAN_TECH_TYPE_UNKNOWN;
+
+	return technology->type_id;
+}
+
+const char *connman_technology_find_by_type(enum connman_tech_type type)
+{
+	if (tech_if == NULL || type <= CONNMAN_TECH_TYPE_UNKNOWN ||
+						type >= CONNMAN_TECH_TYPE_MAX)
+		return NULL;
+
+	if (tech_if->by_type[type] == NULL)
+		return NULL;
+
+	return tech_if->by_type[type]->path;
+}
+
 gboolean connman_technology_is_enabled(const char *path)
 {
 	struct connman_technology *technology;
@@ -798,3 +1327,24 @@ const char *connman_technology_get_tethering_passphrase(const char *path)
 	return technology->tethering_passphrase;
 }
 
+gboolean connman_technology_changed_since(const char *path,
+				uint32_t generation, uint32_t *changed)
+{
+	struct connman_technology *technology;
+	uint32_t mask = 0;
+	int i;
+
+	technology = get_technology(path);
+	if (technology != NULL && technology->generation > generation) {
+		for (i = 0; i < TECHNOLOGY_FIELD_MAX; i++) {
+			if (technology->field_generation[i] > generation)
+				mask |= CONNMAN_TECHNOLOGY_MASK(i);
+		}
+	}
+
+	if (changed != NULL)
+		*changed = mask;
+
+	return mask != 0;
+}
+
@@ -42,7 +42,7 @@ struct cui_selected_service {
 extern GtkBuilder *cui_builder;
 
 void cui_load_theme(void);
-void cui_theme_get_type_icone_and_info(const char *type,
+void cui_theme_get_type_icone_and_info(enum connman_tech_type type,
 					GdkPixbuf **image, const char **info);
 void cui_theme_get_signal_icone_and_info(uint8_t signal_strength,
 					GdkPixbuf **image, const char **info);
@@ -22,6 +22,9 @@
 #include <connman-ui-gtk.h>
 #include <gtkservice.h>
 
+/* Leaves time for the agent dialogs, Connect only replies once done */
+#define CONNECT_TIMEOUT (120 * 1000)
+
 struct _GtkServicePrivate {
 	GtkBox *box;
 
@@ -31,6 +34,8 @@ struct _GtkServicePrivate {
 	GtkImage *security;
 	GtkImage *signal;
 
+	connman_service_t *handle;
+
 	gboolean selected;
 };
 
@@ -132,25 +137,43 @@ static void gtk_service_destroy(GtkWidget *widget)
 								NULL, service);
 	}
 
+	if (priv != NULL) {
+		connman_service_unref(priv->handle);
+		priv->handle = NULL;
+	}
+
 	GTK_WIDGET_CLASS(gtk_service_parent_class)->destroy(widget);
 }
 
+static void service_connect_cb(const struct connman_reply *reply,
+							void *user_data)
+{
+	if (reply->error == 0)
+		return;
+
+	printf("Connecting %s failed: %s\n", reply->path,
+					strerror(-reply->error));
+}
+
 static gboolean gtk_service_button_release_event(GtkWidget *widget,
 							GdkEventButton *event)
 {
 	GtkService *service = GTK_SERVICE(widget);
+	connman_service_t *handle = service->priv->handle;
 	GtkWidget *parent;
 
 	if (event->button != 1 && event->button != 3)
 		goto activate;
 
 	if (event->button == 1) {
-		if (connman_service_is_connected(service->path) == TRUE)
+		if (connman_service_handle_is_connected(handle) == TRUE)
 			connman_service_disconnect(service->path);
 		else {
 			cui_agent_set_selected_service(service->path,
-				connman_service_get_name(service->path));
-			connman_service_connect(service->path);
+				connman_service_handle_get_name(handle));
+			connman_service_connect_async(service->path,
+						CONNECT_TIMEOUT,
+						service_connect_cb, NULL);
 		}
 	} else if (event->button == 3) {
 		service->priv->selected = TRUE;
@@ -177,22 +200,23 @@ static void service_property_changed_cb(const char *path,
 static void service_set_state(GtkService *service)
 {
 	GtkServicePrivate *priv = service->priv;
+	connman_service_t *handle = priv->handle;
 	const struct connman_ipv4 *ipv4;
 	enum connman_state state;
 	GdkPixbuf *image = NULL;
 	const char *ip = NULL;
 	const char *info;
 
-	if (connman_service_is_connected(service->path) == FALSE) {
+	if (connman_service_handle_is_connected(handle) == FALSE) {
 		gtk_widget_set_tooltip_text((GtkWidget *)priv->name, "");
 		return;
 	}
 
-	ipv4 = connman_service_get_ipv4(service->path);
+	ipv4 = connman_service_handle_get_ipv4(handle);
 	if (ipv4 == NULL) {
 		const struct connman_ipv6 *ipv6;
 
-		ipv6 = connman_service_get_ipv6(service->path);
+		ipv6 = connman_service_handle_get_ipv6(handle);
 		if (ipv6 != NULL)
 			ip = ipv6->address;
 	} else
@@ -203,7 +227,7 @@ static void service_set_state(GtkService *service)
 
 	gtk_widget_set_tooltip_text((GtkWidget *)priv->name, ip);
 
-	state = connman_service_get_state(service->path);
+	state = connman_service_handle_get_state(handle);
 	cui_theme_get_state_icone_and_info(state, &image, &info);
 
 	if (image == NULL)
@@ -217,15 +241,17 @@ static void service_set_state(GtkService *service)
 static void service_set_signal(GtkService *service)
 {
 	GtkServicePrivate *priv = service->priv;
+	connman_service_t *handle = priv->handle;
+	enum connman_tech_type type;
 	GdkPixbuf *image = NULL;
-	const char *type, *info;
+	const char *info;
 
-	type = connman_service_get_type(service->path);
+	type = connman_service_handle_get_type_id(handle);
 
-	if (g_strcmp0(type, "wifi") == 0) {
+	if (type == CONNMAN_TECH_TYPE_WIFI) {
 		uint8_t strength;
 
-		strength = connman_service_get_strength(service->path);
+		strength = connman_service_handle_get_strength(handle);
 
 		cui_theme_get_signal_icone_and_info(strength, &image, &info);
 	} else
@@ -241,28 +267,29 @@ static void service_set_signal(GtkService *service)
 
 static void service_set_name(GtkService *service)
 {
+	connman_service_t *handle = service->priv->handle;
 	const char *name;
 	char *markup;
 
-	name = connman_service_get_name(service->path);
+	name = connman_service_handle_get_name(handle);
 	if (name == NULL)
 		name = "- Hidden -";
 
-	if (connman_service_is_favorite(service->path) == TRUE) {
-		if (g_strcmp0(connman_service_get_type(service->path),
-							"wifi") == 0) {
+	if (connman_service_handle_is_favorite(handle) == TRUE) {
+		if (connman_service_handle_get_type_id(handle) ==
+						CONNMAN_TECH_TYPE_WIFI) {
 			markup = g_markup_printf_escaped(
 				"<b>%s</b> <i> (%s) </i>",
 				name,
-				connman_service_get_security(service->path));
+				connman_service_handle_get_security(handle));
 		} else
 			markup = g_markup_printf_escaped("<b>%s</b>", name);
 	} else {
-		if (g_strcmp0(connman_service_get_type(service->path),
-							"wifi") == 0) {
+		if (connman_service_handle_get_type_id(handle) ==
+						CONNMAN_TECH_TYPE_WIFI) {
 			markup = g_markup_printf_escaped(
 				"%s  <i> (%s) </i>", name,
-				connman_service_get_security(service->path));
+				connman_service_handle_get_security(handle));
 		} else
 			markup = g_markup_printf_escaped("%s", name);
 	}
@@ -291,6 +318,7 @@ GtkService *gtk_service_new(const char *path)
 	}
 
 	service->path = path_copy;
+	service->priv->handle = connman_service_ref(path_copy);
 
 	connman_service_set_property_changed_callback(path_copy,
 					service_property_changed_cb,
@@ -144,10 +144,9 @@ static gboolean gtk_technology_button_release_event(GtkWidget *widget,
 
 	if (event->button == 3) {
 		GtkWidget *parent;
-		const char *type;
 
-		type = connman_technology_get_type(technology->path);
-		if (g_strcmp0(type, "wifi") == 0)
+		if (connman_technology_get_type_id(technology->path) ==
+							CONNMAN_TECH_TYPE_WIFI)
 			cui_agent_set_wifi_tethering_settings(technology->path,
 									FALSE);
 		parent = gtk_widget_get_parent (widget);
@@ -263,7 +262,8 @@ GtkTechnology *gtk_technology_new(const gchar *path)
 	connman_technology_set_property_error_callback(technology->path,
 				technology_property_error_cb, technology);
 
-	if (g_strcmp0(connman_technology_get_type(path_copy), "wifi") == 0) {
+	if (connman_technology_get_type_id(path_copy) ==
+						CONNMAN_TECH_TYPE_WIFI) {
 		gtk_widget_set_tooltip_text(GTK_WIDGET(technology),
 				_("Left click to enable/disable\n"
 				"Right click to set tethering information"));
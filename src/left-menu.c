@@ -174,23 +174,22 @@ static void menu_position_func(GtkMenu *menu, gint *out_x, gint *out_y,
 
 static void get_services_cb(void *user_data)
 {
-	GSList *services, *list;
+	const char **services;
+	unsigned int length, i;
 	int item_position = 2;
 
-	services = connman_service_get_services();
+	services = connman_service_borrow_services(&length);
 	if (services == NULL)
 		return;
 
 	gtk_widget_hide(GTK_WIDGET(cui_list_more_item));
 
-	for (list = services; list; list = list->next, item_position++)
-		add_or_update_service(list->data, item_position);
+	for (i = 0; i < length; i++, item_position++)
+		add_or_update_service(services[i], item_position);
 
 	if (item_position > 10)
 		gtk_widget_show(GTK_WIDGET(cui_list_more_item));
 
-	g_slist_free(services);
-
 	/* Reposition left menu after updating the list */
 	gtk_menu_reposition(cui_left_menu);
 }
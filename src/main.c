@@ -24,6 +24,9 @@
 
 #include <config.h>
 
+/* Seconds a scan is reused for when the services menu is popped up again */
+#define SCAN_MAX_AGE 30
+
 GtkBuilder *cui_builder;
 
 static void connman_manager_changed(const char *unused,
@@ -89,6 +92,12 @@ int main(int argc, char *argv[])
 
 	cui_tray_enable();
 
+	connman_service_set_borrowed_strings(TRUE);
+	connman_service_set_cache_mode(TRUE);
+	connman_service_set_lazy_decoding(TRUE);
+	connman_technology_set_borrowed_strings(TRUE);
+	connman_technology_set_scan_max_age(SCAN_MAX_AGE);
+
 	ret = connman_interface_init(connman_up, connman_down, NULL);
 	if (ret < 0)
 		return ret;
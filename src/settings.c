@@ -22,6 +22,7 @@
 #include <connman-ui-gtk.h>
 
 #include <stdlib.h>
+#include <string.h>
 
 #define CUI_SETTINGS_UI_PATH CUI_UI_PATH "/settings.ui"
 
@@ -66,41 +67,37 @@ static void autoconnect_button_toggled(GtkToggleButton *togglebutton,
 				gtk_toggle_button_get_active(togglebutton));
 }
 
-static void update_header(void)
+static void update_header(const struct connman_service_info *info)
 {
+	enum connman_tech_type type;
 	GdkPixbuf *image = NULL;
-	const char *type, *info;
+	const char *text;
 	GtkWidget *widget;
 	gboolean favorite;
 
-	type = connman_service_get_type(path);
-	if (g_strcmp0(type, "wifi") == 0) {
-		uint8_t strength;
-
-		strength = connman_service_get_strength(path);
-
-		cui_theme_get_signal_icone_and_info(strength, &image, &info);
-	} else
-		cui_theme_get_type_icone_and_info(type, &image, &info);
+	type = info->type_id;
+	if (type == CONNMAN_TECH_TYPE_WIFI)
+		cui_theme_get_signal_icone_and_info(info->strength,
+							&image, &text);
+	else
+		cui_theme_get_type_icone_and_info(type, &image, &text);
 
-	set_image(builder, "service_type", image, info);
-	set_label(builder, "service_name",
-			connman_service_get_name(path), "- Hidden -");
+	set_image(builder, "service_type", image, text);
+	set_label(builder, "service_name", info->name, "- Hidden -");
 
-	if (connman_service_is_connected(path) == TRUE)
-		cui_theme_get_state_icone_and_info(
-				connman_service_get_state(path), &image, &info);
+	if (info->state == CONNMAN_STATE_READY ||
+				info->state == CONNMAN_STATE_ONLINE)
+		cui_theme_get_state_icone_and_info(info->state,
+							&image, &text);
 	else
 		image = NULL;
 
-	set_image(builder, "service_state", image, info);
-	set_label(builder, "service_error",
-				connman_service_get_error(path), "");
+	set_image(builder, "service_state", image, text);
+	set_label(builder, "service_error", info->error, "");
 
-	favorite = connman_service_is_favorite(path);
+	favorite = info->favorite;
 
-	set_button_toggle(builder, "service_autoconnect",
-				connman_service_is_autoconnect(path));
+	set_button_toggle(builder, "service_autoconnect", info->autoconnect);
 	widget = set_widget_sensitive(builder,
 				"service_autoconnect", favorite);
 	if (favorite == TRUE) {
@@ -138,13 +135,13 @@ static void set_ipv4_method(const char *method)
 	}
 }
 
-static void update_ipv4(void)
+static void update_ipv4(const struct connman_service_info *info)
 {
 	const struct connman_ipv4 *ipv4, *ipv4_conf;
 	gboolean method_set = FALSE;
 
-	ipv4 = connman_service_get_ipv4(path);
-	ipv4_conf = connman_service_get_ipv4_config(path);
+	ipv4 = info->ipv4;
+	ipv4_conf = info->ipv4_conf;
 
 	if (ipv4 == NULL) {
 		set_entry(builder, "ipv4_address", "", "");
@@ -220,15 +217,15 @@ static void set_ipv6_privacy(const char *privacy)
 		toggle_button("ipv6_priv_disabled");
 }
 
-static void update_ipv6(void)
+static void update_ipv6(const struct connman_service_info *info)
 {
 	const struct connman_ipv6 *ipv6, *ipv6_conf;
 	gboolean method_set = FALSE;
 	gboolean privacy_set = FALSE;
 	char value[6];
 
-	ipv6 = connman_service_get_ipv6(path);
-	ipv6_conf = connman_service_get_ipv6_config(path);
+	ipv6 = info->ipv6;
+	ipv6_conf = info->ipv6_conf;
 
 	if (ipv6 == NULL) {
 		set_entry(builder, "ipv6_address", "", "");
@@ -277,26 +274,18 @@ config:
 		set_ipv6_privacy(ipv6_conf->privacy);
 }
 
-static void update_dns(void)
+static void update_dns(const struct connman_service_info *info)
 {
-	const char *dns, *dns_config, *domains, *domains_config;
-
-	dns = connman_service_get_nameservers(path);
-	dns_config = connman_service_get_nameservers_config(path);
-	domains = connman_service_get_domains(path);
-	domains_config = connman_service_get_domains_config(path);
-
-	set_entry(builder, "nameservers", dns, "");
-	set_entry(builder, "nameservers_conf", dns_config, "");
-	set_entry(builder, "domains", domains, "");
-	set_entry(builder, "domains_conf", domains_config, "");
+	set_entry(builder, "nameservers", info->nameservers, "");
+	set_entry(builder, "nameservers_conf", info->nameservers_conf, "");
+	set_entry(builder, "domains", info->domains, "");
+	set_entry(builder, "domains_conf", info->domains_conf, "");
 }
 
-static void update_timeservers(void)
+static void update_timeservers(const struct connman_service_info *info)
 {
-	set_entry(builder, "timerservers", connman_service_get_timeservers(path), "");
-	set_entry(builder, "timerservers_conf",
-			connman_service_get_timeservers_config(path), "");
+	set_entry(builder, "timerservers", info->timeservers, "");
+	set_entry(builder, "timerservers_conf", info->timeservers_conf, "");
 }
 
 static void enable_proxy_config(gboolean enable)
@@ -320,13 +309,13 @@ static void set_proxy_method(const char *method)
 	}
 }
 
-static void update_proxy(void)
+static void update_proxy(const struct connman_service_info *info)
 {
 	const struct connman_proxy *proxy, *proxy_conf;
 	gboolean method_set = FALSE;
 
-	proxy = connman_service_get_proxy(path);
-	proxy_conf = connman_service_get_proxy_config(path);
+	proxy = info->proxy;
+	proxy_conf = info->proxy_conf;
 
 	if (proxy == NULL) {
 		set_label(builder, "proxy_method", "", "");
@@ -366,11 +355,9 @@ config:
 	set_widget_sensitive(builder, "proxy_settings", TRUE);
 }
 
-static void update_provider(void)
+static void update_provider(const struct connman_service_info *info)
 {
-	const struct connman_provider *provider;
-
-	provider = connman_service_get_provider(path);
+	const struct connman_provider *provider = info->provider;
 
 	if (provider == NULL) {
 		set_label(builder, "provider_host", "", "");
@@ -391,13 +378,11 @@ static void update_provider(void)
 	set_widget_sensitive(builder, "provider_settings", TRUE);
 }
 
-static void update_ethernet(void)
+static void update_ethernet(const struct connman_service_info *info)
 {
-	const struct connman_ethernet *ethernet;
+	const struct connman_ethernet *ethernet = info->ethernet;
 	char value[6];
 
-	ethernet = connman_service_get_ethernet(path);
-
 	if (ethernet == NULL) {
 		set_label(builder, "ethernet_method", "", "");
 		set_label(builder, "ethernet_interface", "", "");
@@ -427,23 +412,93 @@ static void update_ethernet(void)
 	set_widget_sensitive(builder, "ethernet_settings", TRUE);
 }
 
+#define SECTION_HEADER 0
+
+static struct settings_section {
+	uint32_t fields;
+	void (*update)(const struct connman_service_info *info);
+	uint32_t generation;
+} sections[] = {
+	{ CONNMAN_SERVICE_MASK(CONNMAN_SERVICE_NAME) |
+		CONNMAN_SERVICE_MASK(CONNMAN_SERVICE_TYPE) |
+		CONNMAN_SERVICE_MASK(CONNMAN_SERVICE_STRENGTH) |
+		CONNMAN_SERVICE_MASK(CONNMAN_SERVICE_STATE) |
+		CONNMAN_SERVICE_MASK(CONNMAN_SERVICE_ERROR) |
+		CONNMAN_SERVICE_MASK(CONNMAN_SERVICE_FAVORITE) |
+		CONNMAN_SERVICE_MASK(CONNMAN_SERVICE_AUTOCONNECT),
+		update_header },
+	{ CONNMAN_SERVICE_MASK(CONNMAN_SERVICE_IPv4) |
+		CONNMAN_SERVICE_MASK(CONNMAN_SERVICE_IPv4_CONFIGURATION),
+		update_ipv4 },
+	{ CONNMAN_SERVICE_MASK(CONNMAN_SERVICE_IPv6) |
+		CONNMAN_SERVICE_MASK(CONNMAN_SERVICE_IPv6_CONFIGURATION),
+		update_ipv6 },
+	{ CONNMAN_SERVICE_MASK(CONNMAN_SERVICE_NAMESERVERS) |
+	CONNMAN_SERVICE_MASK(CONNMAN_SERVICE_NAMESERVERS_CONFIGURATION) |
+		CONNMAN_SERVICE_MASK(CONNMAN_SERVICE_DOMAINS) |
+		CONNMAN_SERVICE_MASK(CONNMAN_SERVICE_DOMAINS_CONFIGURATION),
+		update_dns },
+	{ CONNMAN_SERVICE_MASK(CONNMAN_SERVICE_TIMESERVERS) |
+		CONNMAN_SERVICE_MASK(CONNMAN_SERVICE_TIMESERVERS_CONFIGURATION),
+		update_timeservers },
+	{ CONNMAN_SERVICE_MASK(CONNMAN_SERVICE_PROXY) |
+		CONNMAN_SERVICE_MASK(CONNMAN_SERVICE_PROXY_CONFIGURATION),
+		update_proxy },
+	{ CONNMAN_SERVICE_MASK(CONNMAN_SERVICE_PROVIDER), update_provider },
+	{ CONNMAN_SERVICE_MASK(CONNMAN_SERVICE_ETHERNET), update_ethernet },
+};
+
+/* Sections are only redrawn when one of their fields changed, unless forced */
+static void update_sections(int first, int last, gboolean force)
+{
+	struct connman_service_info info;
+	connman_service_t *service;
+	uint32_t generation, changed, fields = 0;
+	int i;
+
+	service = connman_service_ref(path);
+	generation = connman_get_generation();
+
+	for (i = first; i <= last; i++) {
+		if (force == FALSE) {
+			connman_service_handle_changed_since(service,
+					sections[i].generation, &changed);
+			if ((changed & sections[i].fields) == 0)
+				continue;
+		}
+
+		fields |= sections[i].fields;
+	}
+
+	if (fields != 0)
+		connman_service_handle_get_snapshot(service, &info, fields);
+
+	for (i = first; i <= last; i++) {
+		if ((fields & sections[i].fields) == 0)
+			continue;
+
+		sections[i].generation = generation;
+		sections[i].update(&info);
+	}
+
+	connman_service_unref(service);
+}
+
 static void service_property_changed_cb(const char *path,
 					const char *property, void *user_data)
 {
-	update_header();
+	update_sections(SECTION_HEADER, SECTION_HEADER, FALSE);
 }
 
-static void service_property_set_cb(const char *path,
-					const char *property, void *user_data)
+static void refresh_settings(gboolean force)
 {
-	update_header();
-	update_ipv4();
-	update_ipv6();
-	update_dns();
-	update_timeservers();
-	update_proxy();
-	update_provider();
-	update_ethernet();
+	/* Pending edits are dropped, so their sections are redrawn too */
+	if (ipv4_changed == TRUE || ipv6_changed == TRUE ||
+			proxy_changed == TRUE || nameservers_changed == TRUE ||
+			domains_changed == TRUE || timeservers_changed == TRUE)
+		force = TRUE;
+
+	update_sections(0, G_N_ELEMENTS(sections) - 1, force);
 
 	ipv4_changed = FALSE;
 	ipv6_changed = FALSE;
@@ -451,9 +506,6 @@ static void service_property_set_cb(const char *path,
 	nameservers_changed = FALSE;
 	domains_changed = FALSE;
 	timeservers_changed = FALSE;
-
-	connman_service_set_property_changed_callback(path,
-					service_property_changed_cb, NULL);
 }
 
 static void service_property_error_cb(const char *path,
@@ -461,7 +513,7 @@ static void service_property_error_cb(const char *path,
 {
 	printf("Error setting %s (%d)\n", property, error);
 
-	service_property_set_cb(NULL, NULL, NULL);
+	refresh_settings(TRUE);
 }
 
 static void toggled_ipv4_method_cb(GtkToggleButton *togglebutton,
@@ -603,42 +655,94 @@ static void settings_cancel_callback(GtkButton *button, gpointer user_data)
 	cui_tray_enable();
 }
 
+static void settings_applied_cb(const char *applied_path, uint32_t applied,
+				uint32_t failed, const int *errors,
+				void *user_data)
+{
+	int i;
+
+	/* The dialog may have been closed, or opened for another service */
+	if (service_settings_dbox == NULL || g_strcmp0(applied_path, path) != 0)
+		return;
+
+	for (i = 0; i < CONNMAN_SERVICE_MAX; i++) {
+		if ((failed & CONNMAN_SERVICE_MASK(i)) != 0)
+			printf("Error setting property %d: %s\n", i,
+							strerror(-errors[i]));
+	}
+
+	refresh_settings(failed != 0);
+}
+
 static void settings_ok_callback(GtkButton *button, gpointer user_data)
 {
-	const char *value;
-	int ret = 0;
+	struct connman_service_config config;
+	struct connman_ipv4 ipv4;
+	struct connman_ipv6 ipv6;
+	struct connman_proxy proxy;
+	uint32_t mask = 0;
+	int ret;
 
-	connman_service_set_property_changed_callback(path,
-					service_property_set_cb, NULL);
+	memset(&config, 0, sizeof(struct connman_service_config));
 
 	if (ipv4_changed == TRUE) {
-		struct connman_ipv4 ipv4;
-
 		get_ipv4_configuration(&ipv4);
-		ret = connman_service_set_ipv4_config(path, &ipv4);
-	} else if (ipv6_changed == TRUE) {
-		struct connman_ipv6 ipv6;
+		config.ipv4 = &ipv4;
+		mask |= CONNMAN_SERVICE_MASK(
+				CONNMAN_SERVICE_IPv4_CONFIGURATION);
+	}
 
+	if (ipv6_changed == TRUE) {
 		get_ipv6_configuration(&ipv6);
-		ret = connman_service_set_ipv6_config(path, &ipv6);
-	} else if (proxy_changed == TRUE) {
-		struct connman_proxy proxy;
+		config.ipv6 = &ipv6;
+		mask |= CONNMAN_SERVICE_MASK(
+				CONNMAN_SERVICE_IPv6_CONFIGURATION);
+	}
 
+	if (proxy_changed == TRUE) {
 		get_proxy_configuration(&proxy);
-		ret = connman_service_set_proxy_config(path, &proxy);
-	} else if (nameservers_changed == TRUE) {
-		value = get_entry_text(builder, "nameservers_conf");
-		ret = connman_service_set_nameservers_config(path, value);
-	} else if (domains_changed == TRUE) {
-		value = get_entry_text(builder, "domains_conf");
-		ret = connman_service_set_domains_config(path, value);
-	} else if (timeservers_changed == TRUE) {
-		value = get_entry_text(builder, "timerservers_conf");
-		ret = connman_service_set_timeservers_config(path, value);
+		config.proxy = &proxy;
+		mask |= CONNMAN_SERVICE_MASK(
+				CONNMAN_SERVICE_PROXY_CONFIGURATION);
+	}
+
+	if (nameservers_changed == TRUE) {
+		config.nameservers = get_entry_text(builder,
+							"nameservers_conf");
+		mask |= CONNMAN_SERVICE_MASK(
+				CONNMAN_SERVICE_NAMESERVERS_CONFIGURATION);
 	}
 
-	if (ret != 0)
-		printf("Unable to set property, code %d\n", ret);
+	if (domains_changed == TRUE) {
+		config.domains = get_entry_text(builder, "domains_conf");
+		mask |= CONNMAN_SERVICE_MASK(
+				CONNMAN_SERVICE_DOMAINS_CONFIGURATION);
+	}
+
+	if (timeservers_changed == TRUE) {
+		config.timeservers = get_entry_text(builder,
+							"timerservers_conf");
+		mask |= CONNMAN_SERVICE_MASK(
+				CONNMAN_SERVICE_TIMESERVERS_CONFIGURATION);
+	}
+
+	if (mask == 0)
+		return;
+
+	ret = connman_service_apply(path, &config, mask,
+					settings_applied_cb, NULL);
+	if (ret != 0) {
+		printf("Unable to set properties, code %d\n", ret);
+		return;
+	}
+
+	/* Sent: the dialog is redrawn from the service once applied */
+	ipv4_changed = FALSE;
+	ipv6_changed = FALSE;
+	proxy_changed = FALSE;
+	nameservers_changed = FALSE;
+	domains_changed = FALSE;
+	timeservers_changed = FALSE;
 }
 
 static void settings_close_callback(GtkDialog *dialog_box,
@@ -757,7 +861,7 @@ gint cui_settings_popup(const char *selected_path)
 	settings_connect_signals();
 
 	/* Force UI update */
-	service_property_set_cb(NULL, NULL, NULL);
+	refresh_settings(TRUE);
 
 	cui_tray_disable();
 
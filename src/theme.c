@@ -33,17 +33,17 @@ void cui_theme_get_tethering_icone_and_info(GdkPixbuf **image,
 		*info = _("Tethering");
 }
 
-void cui_theme_get_type_icone_and_info(const char *type,
+void cui_theme_get_type_icone_and_info(enum connman_tech_type type,
 					GdkPixbuf **image, const char **info)
 {
 	const char *nfo = NULL;
 	GdkPixbuf *img = NULL;
 
-	if (g_strcmp0(type, "ethernet") == 0) {
+	if (type == CONNMAN_TECH_TYPE_ETHERNET) {
 		img = gtk_icon_theme_load_icon(icon_theme,
 					"network-wired-symbolic", 22, 0, NULL);
 		nfo = _("Ethernet");
-	} else if (g_strcmp0(type, "cellular") == 0) {
+	} else if (type == CONNMAN_TECH_TYPE_CELLULAR) {
 		img = gtk_icon_theme_load_icon(icon_theme,
 					"gsm-3g-full", 22, 0, NULL);
 		nfo = _("Cellular");